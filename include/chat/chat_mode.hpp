@@ -38,6 +38,16 @@ public:
     history_manager_ = history_mgr; 
   }
 
+  // Report prompt prefill progress as (tokens decoded, tokens to decode)
+  void SetPrefillProgressCallback(std::function<void(int, int)> callback) {
+    model_loader_.SetPrefillProgressCallback(callback);
+  }
+
+  // Stats of the last model call made by Chat
+  const models::InferenceStats &GetLastStats() const {
+    return model_loader_.GetLastStats();
+  }
+
   // Chat with context
   std::string Chat(const std::string &user_message,
                    const std::vector<std::string> &context_files,
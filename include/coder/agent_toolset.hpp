@@ -29,6 +29,8 @@ public:
     static constexpr int MAX_LIST_ENTRIES = 100;
     static constexpr int MAX_WRITE_LINES = 200;
     static constexpr int MAX_PATH_LENGTH = 256;
+    static constexpr int MAX_BATCH_COMMANDS = 4;
+    static constexpr int MAX_DIFF_LINES = 200;
 
     explicit AgentToolSet(const std::string& working_dir = ".");
 
@@ -50,6 +52,11 @@ public:
     // Returns: exists, line_count, size_bytes (no content!)
     ToolResult FileInfo(const std::string& path);
 
+    // GIT_DIFF <path>
+    // Returns uncommitted changes to a file or directory (git diff)
+    // Capped at MAX_DIFF_LINES lines
+    ToolResult GitDiff(const std::string& path);
+
     // WRITE <path> <start_line> <end_line>
     // Replaces lines [start, end] with new content
     ToolResult WriteLines(const std::string& path, int start_line, int end_line,
@@ -74,6 +81,21 @@ public:
     // Parse and execute a command string from the model
     ToolResult Execute(const std::string& command);
 
+    // Execute up to MAX_BATCH_COMMANDS commands from one step, returning
+    // one result per command. Consecutive read-only commands run
+    // concurrently; any other command runs alone, in order, after every
+    // command before it. Commands after a FINISH are not run.
+    std::vector<ToolResult> ExecuteBatch(const std::vector<std::string>& commands);
+
+    // Combine a batch's results into one, each output under its command
+    static ToolResult MergeResults(const std::vector<std::string>& commands,
+                                   const std::vector<ToolResult>& results);
+
+    // Whether a command only reads (READ_LINES, GREP, LIST, FILE_INFO or
+    // GIT_DIFF), so running it early or concurrently can't change what
+    // other commands see
+    static bool IsReadOnly(const std::string& command);
+
     // Setters
     void SetWorkingDirectory(const std::string& path);
     std::string GetWorkingDirectory() const { return working_dir_; }
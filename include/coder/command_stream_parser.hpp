@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zweek {
+namespace coder {
+
+// Recognizes the agent's commands while its output is still being
+// generated. A command is complete once its "CMD: " line ends, or, for
+// WRITE and INSERT, once the line holding END_WRITE / END_INSERT ends.
+// Each byte is scanned about once, however the text is split.
+class CommandStreamParser {
+public:
+    // Stop after max_commands commands, or after a FINISH
+    explicit CommandStreamParser(size_t max_commands = 1);
+
+    // Append generated text. Returns true once no more commands will be
+    // taken; text fed after that is ignored.
+    bool Feed(std::string_view text);
+
+    bool Complete() const { return complete_; }
+
+    // Completed commands in order, each after "CMD: " through its final
+    // newline
+    const std::vector<std::string>& Commands() const { return commands_; }
+
+    // Bytes fed so far, for callers that only see the whole output
+    size_t Size() const { return buffer_.size(); }
+
+    void Reset();
+
+private:
+    // Try to complete the command being parsed; false if more text is needed
+    bool ParseCommand();
+
+    size_t max_commands_;
+    std::string buffer_;
+    size_t scan_ = 0;                         // Where the next search starts
+    size_t cmd_start_ = std::string::npos;    // Just after "CMD: "
+    size_t line_end_ = std::string::npos;     // Newline ending the CMD line
+    std::string end_marker_;                  // For block commands
+    std::vector<std::string> commands_;
+    bool complete_ = false;
+};
+
+}  // namespace coder
+}  // namespace zweek
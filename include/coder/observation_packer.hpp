@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace zweek {
+namespace coder {
+
+// A tool result cut down to a token budget
+struct PackedObservation {
+    std::string text;       // Kept lines, with a marker where lines were elided
+    int tokens = 0;         // Token count of text
+    int total_lines = 0;    // Lines in the original output
+    int elided_first = 0;   // 1-based range of elided output lines
+    int elided_last = 0;    //   (0 when nothing was elided)
+
+    bool Elided() const { return elided_first > 0; }
+};
+
+// Fits tool output into a token budget by keeping whole lines from the
+// head and tail and eliding the middle. Token counts come from the model's
+// tokenizer and are cached per line, so re-reading overlapping ranges of a
+// file only tokenizes the lines not seen before.
+class ObservationPacker {
+public:
+    using TokenCounter = std::function<int(const std::string&)>;
+
+    explicit ObservationPacker(TokenCounter count_tokens);
+
+    // Builds the line that replaces elided lines, given the 1-based first
+    // and last elided line and the total line count
+    using Marker = std::function<std::string(int, int, int)>;
+
+    // Keep as much of output as fits in budget tokens, marker included
+    PackedObservation Pack(const std::string& output, int budget,
+                           const Marker& marker) const;
+
+    // Tokens in one line (including its newline), cached
+    int LineTokens(const std::string& line) const;
+
+    void ClearCache() { cache_.clear(); }
+    size_t CacheSize() const { return cache_.size(); }
+
+private:
+    TokenCounter count_tokens_;
+    mutable std::unordered_map<std::string, int> cache_;
+
+    static constexpr size_t MAX_CACHED_LINES = 8192;
+};
+
+}  // namespace coder
+}  // namespace zweek
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "coder/agent_toolset.hpp"
+#include "coder/observation_packer.hpp"
 #include "models/model_loader.hpp"
 #include <string>
 #include <vector>
@@ -15,8 +16,8 @@ namespace coder {
 struct AgentStep {
     std::string observation;   // Tool output from previous step (or initial task)
     std::string thought;       // Model's reasoning
-    std::string command;       // The CMD: output from model
-    ToolResult result;         // Result of executing the command
+    std::string command;       // The CMD: output from model (one per line in a batch)
+    ToolResult result;         // Result of executing the command(s), merged
 };
 
 // Agent state
@@ -34,10 +35,22 @@ struct AgentConfig {
     std::string model_path = "models/Qwen3-0.6B-Q8_0.gguf";
     int max_steps = 25;             // Safety limit on iterations
     int max_tokens_per_step = 512;  // Token limit per inference
-    int context_window = 2048;      // Model context size
-    int history_window = 8;         // Max steps to keep in prompt
+    int context_window = 8192;      // Model context size
+    int history_window = 8;         // Max full steps in the transcript (older ones are summarized)
+    int max_plan_lookups = 8;       // Lookups run by the planning phase (0 = no planning)
+    std::string draft_model_path;   // Speculative draft ("" = off); needs the model's vocabulary
+    models::ThreadConfig threads;   // Decode/prefill threads (0 = auto)
+    // q8_0 K/V halves the KV cache versus f16, which pays for the larger window
+    models::KvCacheConfig kv_cache{"q8_0", "q8_0", true};
 };
 
+// Overlay settings from a JSON config file onto config. A missing file
+// leaves config untouched; returns false only for an unreadable or invalid one.
+bool LoadAgentConfigFile(const std::string& path, AgentConfig& config);
+
+// ~/.zweek/config.json
+std::string GetDefaultConfigPath();
+
 // Callbacks for UI integration
 struct AgentCallbacks {
     std::function<void(const std::string&)> on_thought;     // Model is thinking
@@ -47,6 +60,8 @@ struct AgentCallbacks {
     std::function<void(const std::string&)> on_finish;      // Task complete
     std::function<void(const std::string&)> on_error;       // Error occurred
     std::function<void(const std::string&)> on_stream;      // Token streaming
+    std::function<void(int, int)> on_prefill_progress;      // Prompt tokens decoded / total
+    std::function<void(const models::InferenceStats&)> on_inference_stats; // After each step's inference
 };
 
 // The Recursive Language Model Agent
@@ -63,6 +78,12 @@ public:
     void StartTask(const std::string& task_description,
                    const std::string& working_directory);
 
+    // Planning phase: ask the model once for a plan of lookups (files to
+    // read, searches, diffs) and run them all in parallel, so the first
+    // step already sees their results. Returns false if no usable plan
+    // came back; the task then proceeds step by step as usual.
+    bool PlanTask(std::atomic<bool>* interrupt_flag = nullptr);
+
     // Run the full agent loop until FINISH or max_steps
     // Returns final summary or error
     std::string Run(std::atomic<bool>* interrupt_flag = nullptr);
@@ -105,9 +126,47 @@ private:
     int step_count_ = 0;
     std::string final_summary_;
 
-    // Build the prompt from history
+    // Append-only transcript: a fixed header (system prompt and task)
+    // followed by one entry per step. Every step's prompt extends the
+    // previous one, so the KV cache is reused and only the new entry is
+    // tokenized and decoded. Old steps are folded into a summary entry
+    // once the transcript outgrows its budget.
+    struct TranscriptEntry {
+        std::string text;  // Model output and its RESULT block
+        int tokens = 0;
+        std::string summary_line;  // One line per command, for the summary
+    };
+    std::string transcript_header_;
+    int transcript_header_tokens_ = 0;
+    std::vector<std::string> summary_lines_;  // Summarized steps, oldest first
+    std::string summary_text_;
+    int summary_tokens_ = 0;
+    std::vector<TranscriptEntry> transcript_;
+
+    // Fits each tool result into what the prompt budget leaves over
+    ObservationPacker packer_;
+
+    // Build the prompt from the transcript
     std::string BuildPrompt() const;
 
+    // Record a step's output and the result of each of its commands in
+    // the transcript
+    void AppendToTranscript(const std::string& model_output,
+                            const std::vector<std::string>& commands,
+                            const std::vector<ToolResult>& results);
+
+    // Summarize the oldest steps while the transcript is over its token
+    // budget or holds more than history_window full steps
+    void CompactTranscript();
+    int TranscriptTokens() const;
+
+    // Tokens the prompt may use once a step's output is reserved
+    int PromptBudget() const;
+
+    // Tokens available for the next tool result, given the tokens of the
+    // step output that precedes it
+    int ObservationBudget(int step_tokens) const;
+
     // Parse model output into thought + command
     bool ParseModelOutput(const std::string& output,
                           std::string& thought,
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "coder/agent_toolset.hpp"
+#include <string>
+#include <vector>
+
+namespace zweek {
+namespace coder {
+
+// One entry of a plan emitted under grammars::PLANNER_GRAMMAR
+struct PlanStep {
+    std::string type;     // read_file | search | git_diff | write_file
+    std::string path;
+    std::string pattern;  // What a search looks for
+};
+
+// Parse the planner's JSON array into steps. Unknown types and entries
+// without a path are dropped; returns false if json isn't an array.
+bool ParseToolPlan(const std::string& json, std::vector<PlanStep>& steps);
+
+// The AgentToolSet command for a lookup step. Empty for write_file: edits
+// are left to the agent's steps, which see the lookup results first.
+std::string PlanStepCommand(const PlanStep& step);
+
+// Run a plan's lookups. None depends on another, so they all run
+// concurrently, MAX_BATCH_COMMANDS at a time, and at most max_lookups of
+// them. Returns the commands run and one result per command; the paths of
+// write_file steps go to edit_targets.
+std::vector<ToolResult> RunToolPlan(AgentToolSet& toolset,
+                                    const std::vector<PlanStep>& steps,
+                                    size_t max_lookups,
+                                    std::vector<std::string>& commands,
+                                    std::vector<std::string>& edit_targets);
+
+}  // namespace coder
+}  // namespace zweek
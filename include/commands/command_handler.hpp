@@ -52,6 +52,11 @@ public:
     directory_change_callback_ = callback;
   }
   
+  // Set provider of the routing statistics shown by /routes
+  void SetRoutingStatsProvider(std::function<std::string()> provider) {
+    routing_stats_provider_ = provider;
+  }
+
   // Get list of available commands for autocomplete
   std::vector<std::string> GetAvailableCommands() const;
 
@@ -62,6 +67,7 @@ private:
   chat::ChatMode* chat_mode_ = nullptr;
   tools::ToolExecutor* tool_executor_ = nullptr;
   std::function<void(const std::string&)> directory_change_callback_;
+  std::function<std::string()> routing_stats_provider_;
   std::vector<std::string> cached_sessions_;
 };
 
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace zweek {
+namespace logging {
+
+enum class LogLevel { Debug = 0, Info = 1, Warn = 2, Error = 3 };
+
+// Process-wide asynchronous logger. Log() copies the message into a
+// fixed-size lock-free ring and returns; a writer thread drains the ring
+// into a rotating file. When the ring is full the message is dropped (and
+// counted) rather than making the caller wait, so logging is safe on the
+// inference thread.
+class Logger {
+public:
+  static Logger &Instance();
+
+  // Start writing to dir/zweek.log. The file is rotated to zweek.1.log ...
+  // once it exceeds max_bytes, keeping max_files old files. The level is
+  // taken from ZWEEK_LOG_LEVEL (debug, info, warn, error) if set. Returns
+  // false if the directory or file cannot be opened.
+  bool Start(const std::string &dir = GetDefaultLogDir(),
+             size_t max_bytes = 4 * 1024 * 1024, int max_files = 3);
+
+  // Write out everything queued and stop the writer thread
+  void Stop();
+
+  void SetLevel(LogLevel level) { level_.store(level); }
+  LogLevel GetLevel() const { return level_.load(); }
+
+  // Queue one line. Messages longer than a ring slot are truncated.
+  void Log(LogLevel level, std::string_view component,
+           std::string_view message);
+
+  // Messages lost because the ring was full
+  uint64_t DroppedCount() const { return dropped_.load(); }
+
+  // ~/.zweek/logs
+  static std::string GetDefaultLogDir();
+
+private:
+  Logger();
+  ~Logger();
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  static constexpr size_t RING_SLOTS = 1024; // Power of two
+  static constexpr size_t MAX_MESSAGE_BYTES = 240;
+
+  // Bounded multi-producer ring (Vyukov): a slot is free for the producer
+  // at position p when sequence == p, and ready for the consumer when
+  // sequence == p + 1
+  struct Slot {
+    std::atomic<size_t> sequence{0};
+    LogLevel level = LogLevel::Info;
+    int64_t time_ms = 0;
+    uint16_t length = 0;
+    char text[MAX_MESSAGE_BYTES];
+  };
+
+  bool Pop(Slot &out);
+  void WriterLoop();
+  void WriteLine(const Slot &slot);
+  void RotateIfNeeded();
+
+  std::unique_ptr<std::array<Slot, RING_SLOTS>> ring_;
+  std::atomic<size_t> enqueue_pos_{0};
+  size_t dequeue_pos_ = 0;  // Writer thread only
+
+  std::atomic<LogLevel> level_{LogLevel::Info};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t reported_drops_ = 0;  // Drops already noted in the file
+  std::atomic<bool> running_{false};
+
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::thread writer_;
+
+  // Owned by the writer thread while running
+  std::ofstream file_;
+  std::string path_;
+  size_t file_bytes_ = 0;
+  size_t max_bytes_ = 0;
+  int max_files_ = 0;
+};
+
+// Convenience wrappers
+inline void LogDebug(std::string_view component, std::string_view message) {
+  Logger::Instance().Log(LogLevel::Debug, component, message);
+}
+inline void LogInfo(std::string_view component, std::string_view message) {
+  Logger::Instance().Log(LogLevel::Info, component, message);
+}
+inline void LogWarn(std::string_view component, std::string_view message) {
+  Logger::Instance().Log(LogLevel::Warn, component, message);
+}
+inline void LogError(std::string_view component, std::string_view message) {
+  Logger::Instance().Log(LogLevel::Error, component, message);
+}
+
+} // namespace logging
+} // namespace zweek
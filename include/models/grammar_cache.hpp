@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Forward declare llama.cpp types
+struct llama_vocab;
+struct llama_sampler;
+
+namespace zweek {
+namespace models {
+
+// Process-wide cache of parsed sampler chains. Parsing a GBNF grammar is
+// done once per (vocab, grammar text); every request gets a clone of the
+// untouched prototype, so grammar state never leaks between requests.
+class GrammarCache {
+public:
+  static GrammarCache &Instance();
+
+  // New sampler chain (grammar if non-empty, then top-k/top-p/temp and a
+  // freshly seeded dist sampler). The caller owns the returned chain.
+  llama_sampler *CreateChain(const llama_vocab *vocab,
+                             const std::string &grammar);
+
+  // The grammar sampler at the head of a chain from CreateChain, or nullptr
+  // if the chain has none (no grammar, or it failed to parse)
+  static llama_sampler *GrammarStage(llama_sampler *chain);
+
+  // Free every prototype built for vocab (called before its model is freed)
+  void Evict(const llama_vocab *vocab);
+
+  // Number of cached prototypes
+  size_t Size();
+
+private:
+  GrammarCache() = default;
+  ~GrammarCache();
+  GrammarCache(const GrammarCache &) = delete;
+  GrammarCache &operator=(const GrammarCache &) = delete;
+
+  std::mutex mutex_;
+  std::map<std::pair<const llama_vocab *, std::string>, llama_sampler *>
+      prototypes_;
+};
+
+} // namespace models
+} // namespace zweek
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace zweek {
+namespace models {
+
+// Process-wide llama.cpp backend. Initialized once, on first use, and
+// freed at exit, so destroying one ModelLoader never tears the backend
+// down under the others. llama.cpp and ggml log output is routed to the
+// Logger instead of stderr, which belongs to the TUI.
+class LlamaBackend {
+public:
+  static void EnsureInitialized();
+
+private:
+  LlamaBackend();
+  ~LlamaBackend();
+  LlamaBackend(const LlamaBackend &) = delete;
+  LlamaBackend &operator=(const LlamaBackend &) = delete;
+};
+
+} // namespace models
+} // namespace zweek
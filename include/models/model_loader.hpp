@@ -1,9 +1,13 @@
 #pragma once
 
+#include "models/piece_table.hpp"
+#include "models/thread_config.hpp"
 #include <string>
 #include <vector>
 #include <functional>
 #include <atomic>
+#include <cstdint>
+#include <memory>
 
 // Forward declare llama.cpp types
 struct llama_model;
@@ -13,6 +17,55 @@ struct llama_sampler;
 namespace zweek {
 namespace models {
 
+// One prompt in a batched inference call
+struct InferRequest {
+  std::string prompt;
+  std::string grammar;  // GBNF grammar ("" = unconstrained)
+  int max_tokens = 256;
+  std::function<void(const std::string &)> stream_callback;
+  // Generation ends at the first stop sequence (matched across token
+  // boundaries and left out of the result and the stream)
+  std::vector<std::string> stop;
+  // Called with the text generated so far after each token; returning true
+  // ends generation (e.g. once a complete command line has been produced)
+  std::function<bool(const std::string &)> stop_when;
+};
+
+// KV cache storage for a loader's contexts
+struct KvCacheConfig {
+  std::string type_k = "f16"; // f32, f16, bf16, q8_0, q5_1, q5_0, q4_1, q4_0
+  std::string type_v = "f16";
+  bool flash_attn = false;    // Off = llama.cpp's default (auto). Forced on
+                              // for a quantized V cache, which requires it.
+};
+
+// Timing of one Infer call
+struct InferenceStats {
+  int prompt_tokens = 0;        // Tokens in the prompt
+  int prefill_tokens = 0;       // Prompt tokens actually decoded (not cached)
+  int generated_tokens = 0;
+  int drafted_tokens = 0;       // Speculative drafts verified
+  int accepted_tokens = 0;      // Drafts accepted
+  int context_shifts = 0;       // Times the KV cache was shifted to make room
+  int forced_tokens = 0;        // Grammar-forced tokens decoded without sampling
+  double context_recreate_ms = 0.0;
+  double prefill_ms = 0.0;
+  double ttft_ms = 0.0;         // Call start to first generated token
+  double decode_ms = 0.0;       // First generated token to the end
+  double sample_ms = 0.0;       // Time inside llama_sampler_sample
+  bool grammar_active = false;
+
+  double PrefillTokensPerSec() const {
+    return prefill_ms > 0.0 ? prefill_tokens * 1000.0 / prefill_ms : 0.0;
+  }
+  // Tokens after the first, over the time after the first
+  double DecodeTokensPerSec() const {
+    return decode_ms > 0.0 && generated_tokens > 1
+               ? (generated_tokens - 1) * 1000.0 / decode_ms
+               : 0.0;
+  }
+};
+
 // Model loader with GBNF and resident support
 class ModelLoader {
 public:
@@ -31,6 +84,33 @@ public:
                     std::function<void(const std::string &)> stream_callback,
                     std::atomic<bool>* interrupt_flag = nullptr);
 
+  // Same, with stop sequences and a stop condition
+  std::string Infer(const InferRequest &request,
+                    std::atomic<bool>* interrupt_flag = nullptr);
+
+  // Run several prompts together. Each request decodes in its own
+  // sequence with its own sampler chain, and all active sequences share one
+  // llama_decode per step. At most GetMaxParallelSequences() run at once;
+  // the rest join as earlier ones finish. Returns the raw generated text of
+  // each request, in order. The prefix cache used by Infer is left intact
+  // unless the KV cache runs out of room.
+  std::vector<std::string> InferBatch(const std::vector<InferRequest> &requests,
+                                      std::atomic<bool> *interrupt_flag = nullptr);
+
+  // Score how likely each label is to come next after prompt, from a single
+  // forward pass: the logits of each label's first token are compared and
+  // softmax-normalised over the labels. Returns one probability per label,
+  // or an empty vector if the prompt fails to decode or two labels start
+  // with the same token.
+  std::vector<float> ScoreLabels(const std::string &prompt,
+                                 const std::vector<std::string> &labels);
+
+  // Sequences InferBatch decodes at the same time
+  static int GetMaxParallelSequences();
+
+  // Stats of the most recent Infer call
+  const InferenceStats &GetLastStats() const { return last_stats_; }
+
   // Unload model (only if not resident)
   void Unload();
 
@@ -40,17 +120,202 @@ public:
   // Check if model is resident
   bool IsResident() const { return is_resident_; }
 
+  // Release the model to save memory, remembering how to reload it; the
+  // next inference call reloads it transparently. Resident models are
+  // never evicted. Used by ResidencyManager.
+  bool Evict();
+  bool IsEvicted() const { return evicted_; }
+
+  // Halve the context size (not below 512) to free KV cache memory. The
+  // requested size comes back on the next call once memory pressure is
+  // gone. Clears the KV cache.
+  bool ShrinkContext();
+  int GetContextSize() const { return n_ctx_; }
+
+  // Name shown for this loader's context in memory reports
+  void SetName(const std::string &name) { name_ = name; }
+  const std::string &GetName() const { return name_; }
+
+  // Reuse the KV cache across calls by matching the new prompt against the
+  // tokens already decoded (enabled by default). When disabled, every call
+  // starts from a fresh context.
+  void SetPrefixCaching(bool enabled) { prefix_caching_ = enabled; }
+  bool IsPrefixCaching() const { return prefix_caching_; }
+
+  // When generation fills the context, keep the prefix warmed by
+  // WarmPrefix, discard the oldest half of the tokens after it and keep
+  // decoding (enabled by default). When disabled, generation stops at the
+  // context limit.
+  void SetContextShift(bool enabled) { context_shift_ = enabled; }
+  bool IsContextShift() const { return context_shift_; }
+
+  // Drop everything held in the KV cache
+  void ClearCache();
+
+  // Number of tokens currently held in the KV cache
+  size_t GetCachedTokenCount() const { return cached_tokens_.size(); }
+
+  // Tokens text takes as a continuation of a prompt (no BOS)
+  int CountTokens(const std::string &text);
+
+  // Prefill a fixed prompt prefix (e.g. a system prompt) so later calls that
+  // start with it only decode the rest. The post-prefill state is saved to
+  // the state cache directory and restored on the next launch instead of
+  // decoding again. Returns false if the prefix could not be prefilled.
+  bool WarmPrefix(const std::string &prefix);
+
+  // Number of prompt tokens decoded per llama_decode call during prefill
+  // (clamped to the context's n_batch). The interrupt flag and progress
+  // callback are checked between chunks.
+  void SetPrefillChunkSize(int n_tokens) { prefill_chunk_size_ = n_tokens; }
+
+  // Called after each prefill chunk with (tokens decoded, tokens to decode),
+  // and with (0, 0) if the prefill is interrupted or fails
+  void SetPrefillProgressCallback(std::function<void(int, int)> callback) {
+    prefill_progress_callback_ = callback;
+  }
+
+  // Speculative decoding: a small draft model proposes up to max_draft
+  // tokens which this model verifies in a single batched decode. The draft
+  // length adapts to the recent acceptance rate. Drafts from a model with
+  // a different vocabulary are bridged through text, which rarely pays off.
+  // Returns false (and decodes normally) if the draft model cannot be
+  // loaded.
+  bool EnableSpeculativeDecoding(const std::string &draft_model_path,
+                                 int max_draft = 8);
+  void DisableSpeculativeDecoding();
+  bool IsSpeculative() const { return draft_ != nullptr; }
+
+  // Thread counts for decode and prefill. Applies to the current context
+  // immediately; automatic counts are resolved on the next Load.
+  void SetThreadConfig(const ThreadConfig &config);
+  int GetDecodeThreads() const { return n_threads_decode_; }
+  int GetPrefillThreads() const { return n_threads_prefill_; }
+
+  // Measure prefill and decode speed at several thread counts, keep the
+  // fastest of each and cache them for this model. Runs automatically on
+  // the first Load of a model when the counts are automatic. Clears the
+  // KV cache.
+  bool CalibrateThreads();
+
+  // KV cache types and flash attention. Recreates the context if loaded
+  // (dropping the KV cache). Returns false for an unknown type name.
+  bool SetKvCacheConfig(const KvCacheConfig &config);
+  const KvCacheConfig &GetKvCacheConfig() const { return kv_config_; }
+
+  // Directory for saved prefix states (empty disables the disk cache)
+  void SetStateCacheDir(const std::string &dir) { state_cache_dir_ = dir; }
+  static std::string GetDefaultStateCacheDir();
+
 private:
-  llama_model *model_ = nullptr;
+  std::shared_ptr<llama_model> model_handle_; // Shared via ModelRegistry
+  llama_model *model_ = nullptr;               // model_handle_.get()
   llama_context *ctx_ = nullptr;
   llama_sampler *sampler_ = nullptr;
+  std::shared_ptr<const PieceTable> pieces_;   // Token text of model_
   bool is_resident_ = false;
+  bool prefix_caching_ = true;
+  bool context_shift_ = true;
+  size_t n_keep_ = 0;          // Tokens a context shift never discards
+  std::string name_;
   int n_ctx_ = 512;
+  int requested_n_ctx_ = 512;  // n_ctx_ before any shrinking
+  bool evicted_ = false;
+  bool residency_managed_ = true; // Drafts are managed with their target
+  int n_batch_ = 512;
+  int prefill_chunk_size_ = 512;
+  std::function<void(int, int)> prefill_progress_callback_;
+  std::string model_path_;
+  std::string model_fingerprint_;
+  std::string state_cache_dir_ = GetDefaultStateCacheDir();
+
+  KvCacheConfig kv_config_;
+
+  // Threading
+  ThreadConfig thread_config_;
+  int n_threads_decode_ = 1;
+  int n_threads_prefill_ = 1;
+
+  // Speculative decoding state
+  std::unique_ptr<ModelLoader> draft_;
+  std::string draft_model_path_;
+  bool draft_vocab_compatible_ = false;
+  size_t draft_window_start_ = 0; // Start of the context the draft sees
+  static constexpr int MAX_DRAFT_CTX = 2048;
+  int max_draft_ = 8;
+  int n_draft_ = 4;
+  float draft_acceptance_ = 0.5f; // Moving average of accepted / drafted
+
+  InferenceStats last_stats_;
+
+  // Single-character and end-of-generation tokens of the vocab, used to
+  // probe the grammar for forced text (built on first use)
+  std::vector<int32_t> jump_probe_tokens_;
+
+  // Tokens whose KV entries are live in sequence 0 of ctx_
+  std::vector<int32_t> cached_tokens_;
+
+  // Text of the last prompt plus its decoded output, and its tokens. A
+  // prompt that starts with this text reuses the tokens.
+  std::string token_cache_text_;
+  std::vector<int32_t> token_cache_tokens_;
+
+  // (Re)create ctx_ for the loaded model
+  bool CreateContext();
+
+  // Tokenize a prompt, reusing the tokens of the previous prompt and its
+  // output when the new prompt extends them (append-only transcripts)
+  std::vector<int32_t> TokenizePrompt(const std::string &prompt);
+
+  // Text the grammar admits as the only continuation (up to max_len ASCII
+  // characters), found by probing one character at a time. Advances
+  // grammar past the returned text.
+  std::string ForcedText(llama_sampler *grammar, size_t max_len);
+
+  // Make room for n_needed more tokens in sequence 0 by discarding the
+  // oldest half of the tokens after the first n_keep_ and shifting the
+  // rest back. Returns false if that would not free enough space.
+  bool ShiftContext(int n_needed);
+
+  // Reload after eviction or restore a shrunk context, and mark this loader
+  // as recently used. Called at the start of every inference entry point.
+  void EnsureReady();
+
+  // Pick thread counts (explicit, calibrated or physical cores) and apply
+  // them, with the shared threadpools, to ctx_
+  void ResolveThreads();
+  void ApplyThreads();
+
+  // Content fingerprint of the model file (computed once per load)
+  const std::string &Fingerprint();
+
+  // New sampler chain with the standard settings, constrained by grammar
+  // if non-empty. Cloned from GrammarCache; the caller owns the chain.
+  llama_sampler *CreateSamplerChain(const std::string &grammar);
+
+  // Interrupt flag of the inference in progress, polled by llama.cpp's
+  // abort callback so a long decode can be cancelled mid-graph
+  std::atomic<bool> *active_interrupt_ = nullptr;
+  static bool ShouldAbort(void *data);
+
+  // Decode whatever part of tokens is not already in the KV cache, in
+  // chunks. Returns false on failure or interruption.
+  bool DecodePrompt(const std::vector<int32_t> &tokens,
+                    std::atomic<bool> *interrupt_flag = nullptr);
+
+  // Greedily draft up to n tokens (in this model's vocab) continuing a
+  // context given both as this model's tokens and as text
+  std::vector<int32_t> DraftTokens(const std::vector<int32_t> &context_tokens,
+                                   const std::string &context_text, int n);
+
+  // Grow or shrink the draft length from the latest verification
+  void UpdateDraftLength(size_t n_accepted, size_t n_drafted);
+
+  // State cache file for a prefix, keyed by model, tokens and context params
+  std::string StateCachePath(const std::vector<int32_t> &tokens);
 
   // Internal inference
-  std::string RunInference(const std::string &prompt,
-                           const std::string &grammar, int max_tokens,
-                           std::function<void(const std::string &)> stream_callback,
+  std::string RunInference(const InferRequest &request,
                            std::atomic<bool>* interrupt_flag);
 };
 
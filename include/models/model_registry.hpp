@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Forward declare llama.cpp types
+struct llama_model;
+struct llama_context;
+
+namespace zweek {
+namespace models {
+
+// Load-time parameters that change the weights in memory (part of the key)
+struct ModelParams {
+  int n_gpu_layers = 0;
+  bool use_mmap = true;
+  bool use_mlock = false;
+};
+
+// Memory held by one consumer's context
+struct ContextMemoryInfo {
+  std::string owner;      // Consumer name (e.g. "chat", "agent")
+  int n_ctx = 0;          // Context size in tokens
+  uint64_t kv_bytes = 0;  // KV cache size
+  std::string kv_type;    // K/V cache types (e.g. "q8_0/q8_0")
+};
+
+// Memory held by one shared model and the contexts built on it
+struct ModelMemoryInfo {
+  std::string path;
+  uint64_t weights_bytes = 0;
+  long ref_count = 0;     // Number of loaders holding the weights
+  std::vector<ContextMemoryInfo> contexts;
+};
+
+// Process-wide registry of loaded models. Every consumer that asks for the
+// same file with the same params gets the same reference-counted weights;
+// each consumer still creates its own llama_context on top of them.
+class ModelRegistry {
+public:
+  static ModelRegistry &Instance();
+
+  // Get a shared handle to a model, loading it on first request.
+  // The weights are freed when the last handle is released.
+  std::shared_ptr<llama_model> Acquire(const std::string &model_path,
+                                       const ModelParams &params = {});
+
+  // Whether the weights for this file and params are already in memory
+  bool IsLoaded(const std::string &model_path, const ModelParams &params = {});
+
+  // Track a consumer's context for memory reporting
+  void RegisterContext(const llama_context *ctx, const llama_model *model,
+                       const std::string &owner, int n_ctx,
+                       uint64_t kv_bytes, const std::string &kv_type = "");
+  void UnregisterContext(const llama_context *ctx);
+
+  // Memory used by each loaded model and its contexts
+  std::vector<ModelMemoryInfo> GetMemoryReport();
+
+  // Human-readable memory report
+  std::string FormatMemoryReport();
+
+  // Estimate the KV cache size of an n_ctx context on model, given the
+  // ggml_type of the K and V caches
+  static uint64_t EstimateKvCacheBytes(const llama_model *model, int n_ctx,
+                                       int type_k, int type_v);
+
+private:
+  ModelRegistry() = default;
+  ModelRegistry(const ModelRegistry &) = delete;
+  ModelRegistry &operator=(const ModelRegistry &) = delete;
+
+  struct ModelEntry {
+    std::string path;
+    const llama_model *model = nullptr;
+    std::weak_ptr<llama_model> handle;
+  };
+
+  struct ContextEntry {
+    const llama_model *model = nullptr;
+    ContextMemoryInfo info;
+  };
+
+  // Called by the handle's deleter when the last reference goes away
+  void Release(const std::string &key, llama_model *model);
+
+  std::mutex mutex_;
+  std::map<std::string, ModelEntry> models_;            // key -> model
+  std::map<const llama_context *, ContextEntry> contexts_;
+};
+
+} // namespace models
+} // namespace zweek
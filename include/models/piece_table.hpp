@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Forward declare llama.cpp types
+struct llama_vocab;
+
+namespace zweek {
+namespace models {
+
+// Text of every token in a vocab, decoded once so generation can look
+// pieces up instead of calling llama_token_to_piece for every token.
+// Tables are shared by every loader using the same model.
+class PieceTable {
+public:
+  // Table for vocab, built on first request
+  static std::shared_ptr<const PieceTable> For(const llama_vocab *vocab);
+
+  // Drop the cached table (called before its model is freed)
+  static void Evict(const llama_vocab *vocab);
+
+  // Piece as llama_token_to_piece renders it without special tokens
+  // (control tokens are empty). Empty for out-of-range tokens.
+  std::string_view Get(int32_t token) const {
+    if (token < 0 || (size_t)token + 1 >= offsets_.size()) {
+      return {};
+    }
+    return std::string_view(text_).substr(
+        offsets_[token], offsets_[token + 1] - offsets_[token]);
+  }
+
+  size_t Size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+
+private:
+  explicit PieceTable(const llama_vocab *vocab);
+
+  std::string text_;              // All pieces, back to back
+  std::vector<uint32_t> offsets_; // Start of each token's piece, plus end
+};
+
+} // namespace models
+} // namespace zweek
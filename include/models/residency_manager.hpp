@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace zweek {
+namespace models {
+
+class ModelLoader;
+
+// System memory state from /proc/meminfo and /proc/pressure/memory
+struct MemoryPressure {
+  uint64_t total_bytes = 0;     // MemTotal (0 if unknown)
+  uint64_t available_bytes = 0; // MemAvailable
+  float psi_some_avg10 = -1.0f; // % of time some task stalled on memory (-1 = no PSI)
+  bool under_pressure = false;
+};
+
+// Keeps loaded models (weights + KV caches, as reported by ModelRegistry)
+// within a RAM budget. Before a load would exceed it, least recently used
+// non-resident loaders are evicted; they reload transparently on their
+// next inference. Under system memory pressure idle loaders are evicted
+// first, then their contexts shrunk.
+//
+// Not thread-safe with respect to the loaders themselves: call it from the
+// thread that runs inference (the inference service worker).
+class ResidencyManager {
+public:
+  static ResidencyManager &Instance();
+
+  // RAM budget for all models. Defaults to ZWEEK_MEMORY_BUDGET_MB if set,
+  // otherwise 3 GiB capped at 75% of physical memory.
+  void SetBudgetBytes(uint64_t bytes) { budget_bytes_ = bytes; }
+  uint64_t GetBudgetBytes() const { return budget_bytes_; }
+
+  // Called by ModelLoader on load, unload and every inference
+  void Register(ModelLoader *loader);
+  void Unregister(ModelLoader *loader);
+  void Touch(ModelLoader *loader);
+
+  // Evict least recently used loaders (never requester or resident ones)
+  // until current usage plus incoming_bytes fits in the budget
+  void MakeRoom(const ModelLoader *requester, uint64_t incoming_bytes);
+
+  // Read system pressure and, if under pressure, evict one idle loader or
+  // shrink one context. Returns true if anything was released.
+  bool CheckPressure();
+
+  // Latest pressure reading (refreshed at most once per second)
+  bool UnderPressure();
+
+  // Weights plus KV caches of everything loaded
+  uint64_t CurrentUsage();
+
+  // Budget, usage, system pressure and eviction counts for /memory
+  std::string FormatStatus();
+
+  static MemoryPressure ReadSystemPressure();
+
+private:
+  ResidencyManager();
+  ResidencyManager(const ResidencyManager &) = delete;
+  ResidencyManager &operator=(const ResidencyManager &) = delete;
+
+  // Least recently used loader that may be evicted, or nullptr
+  ModelLoader *PickVictim(const ModelLoader *requester);
+
+  std::mutex mutex_;
+  std::map<ModelLoader *, std::chrono::steady_clock::time_point> last_used_;
+  uint64_t budget_bytes_ = 0;
+  int evictions_ = 0;
+  int shrinks_ = 0;
+
+  MemoryPressure last_pressure_;
+  std::chrono::steady_clock::time_point last_pressure_read_;
+};
+
+} // namespace models
+} // namespace zweek
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zweek {
+namespace models {
+
+// Finds stop sequences in streamed text, even when a sequence is split
+// across token pieces. Text that could still turn out to be the start of a
+// stop sequence is held back until it is ruled out, so a stop sequence is
+// never released to the caller.
+class StopSequenceMatcher {
+public:
+  explicit StopSequenceMatcher(const std::vector<std::string> &stops = {});
+
+  // Append generated text. Returns the part that is now known not to
+  // belong to a stop sequence. Once a stop sequence completes, returns the
+  // text before it and Matched() becomes true; later calls return "".
+  // The returned view is valid until the next call.
+  std::string_view Feed(std::string_view text);
+
+  // Text still held back (call when generation ends without a match)
+  std::string_view Flush();
+
+  bool Matched() const { return matched_; }
+
+  // Forget all fed text and any match
+  void Reset();
+
+private:
+  std::vector<std::string> stops_;
+  std::string held_;      // Unreleased tail of the fed text
+  std::string released_;  // Backing store for returned views
+  bool matched_ = false;
+};
+
+} // namespace models
+} // namespace zweek
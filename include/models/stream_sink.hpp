@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace zweek {
+namespace models {
+
+// Batches streamed text so consumers get one callback per few tokens
+// instead of one per token. Pieces are copied into a reused buffer, which
+// is handed to the callback by reference, so streaming does not allocate.
+class StreamSink {
+public:
+  using Callback = std::function<void(const std::string &)>;
+
+  // Flush after flush_tokens pieces, or on the first piece written
+  // flush_interval after the previous flush (about one frame by default).
+  // A slow stream is therefore delivered token by token.
+  explicit StreamSink(Callback callback, size_t flush_tokens = 8,
+                      std::chrono::microseconds flush_interval =
+                          std::chrono::microseconds(16000));
+
+  // Append one token's text
+  void Write(std::string_view piece);
+
+  // Deliver anything pending
+  void Flush();
+
+private:
+  Callback callback_;
+  size_t flush_tokens_;
+  std::chrono::microseconds flush_interval_;
+  std::string buffer_;
+  size_t pending_ = 0;  // Pieces in buffer_
+  std::chrono::steady_clock::time_point last_flush_;
+};
+
+} // namespace models
+} // namespace zweek
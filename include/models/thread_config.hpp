@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Forward declare ggml types
+struct ggml_threadpool;
+
+namespace zweek {
+namespace models {
+
+// Threads used by a model's contexts. 0 = automatic (calibrated value if
+// one is cached for the model, otherwise the number of physical cores).
+struct ThreadConfig {
+  int n_threads_decode = 0;  // Single-token generation (memory bound)
+  int n_threads_prefill = 0; // Prompt batches (compute bound)
+  bool pin_threads = false;  // Pin pool threads to one CPU per physical core
+  bool calibrate = true;     // Measure the best counts on first load of a model
+};
+
+// Logical CPU ids, one per physical core (first SMT sibling), in order.
+// Falls back to 0..n-1 from std::thread::hardware_concurrency().
+const std::vector<int> &GetPhysicalCpus();
+
+// Process-wide ggml threadpools, one per (thread count, pinning). Pools are
+// created on first use and reused by every context, so recreating a
+// context does not spin up new threads. Contexts that share a pool must
+// not decode concurrently (the inference service runs one job at a time).
+class ThreadPools {
+public:
+  static ThreadPools &Instance();
+
+  // Pool with n threads; nullptr if ggml cannot create one (llama.cpp then
+  // uses its own per-decode threads)
+  ggml_threadpool *Get(int n_threads, bool pin);
+
+private:
+  ThreadPools() = default;
+  ~ThreadPools();
+  ThreadPools(const ThreadPools &) = delete;
+  ThreadPools &operator=(const ThreadPools &) = delete;
+
+  std::mutex mutex_;
+  std::map<std::pair<int, bool>, ggml_threadpool *> pools_;
+};
+
+// Best thread counts measured for a model on this machine, cached in
+// ~/.zweek/cache/threads.json keyed by model fingerprint and core count
+bool LoadCalibratedThreads(const std::string &model_fingerprint,
+                           int &n_threads_decode, int &n_threads_prefill);
+void SaveCalibratedThreads(const std::string &model_fingerprint,
+                           int n_threads_decode, int n_threads_prefill);
+
+} // namespace models
+} // namespace zweek
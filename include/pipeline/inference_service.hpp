@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zweek {
+namespace pipeline {
+
+// Scheduling priority. A job preempts running work of lower priority.
+enum class Priority {
+  Background = 0, // Summaries, prefetch, warmup
+  Normal = 1,
+  Foreground = 2  // The request the user is waiting on
+};
+
+// Thread-safe stream of text chunks from a running job to a consumer
+class TokenChannel {
+public:
+  void Push(const std::string &chunk);
+
+  // Block until a chunk is available. Returns false once the channel is
+  // closed and drained.
+  bool Pop(std::string &chunk);
+
+  // Non-blocking Pop; false if nothing is queued right now
+  bool TryPop(std::string &chunk);
+
+  // Called by the service when the job finishes
+  void Close();
+  bool IsClosed();
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::string> chunks_;
+  bool closed_ = false;
+};
+
+// What a running job gets from the service
+struct JobContext {
+  // Set when the job is cancelled or preempted; pass it to Infer() as the
+  // interrupt flag and return promptly once it is set
+  std::atomic<bool> *cancel = nullptr;
+  // Stream partial output here
+  TokenChannel *tokens = nullptr;
+};
+
+using InferenceJob = std::function<std::string(JobContext &)>;
+
+// Handle to a submitted job
+class InferenceHandle {
+public:
+  // Final text returned by the job (or an "[Error: ...]"/"[cancelled]"
+  // string if it never ran)
+  std::shared_future<std::string> Result() const { return result_; }
+
+  // Streamed chunks; closed when the job finishes
+  std::shared_ptr<TokenChannel> Tokens() const { return tokens_; }
+
+  // Cooperative cancellation: a queued job is dropped, a running job sees
+  // its cancel flag set
+  void Cancel();
+
+  bool IsValid() const { return result_.valid(); }
+
+private:
+  friend class InferenceService;
+  std::shared_future<std::string> result_;
+  std::shared_ptr<TokenChannel> tokens_;
+  std::shared_ptr<std::atomic<bool>> cancel_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Runs every job that touches the models on one dedicated worker thread,
+// so model state is never used from two threads at once. Jobs wait in a
+// bounded queue ordered by priority, then submission order. Submitting a
+// job of higher priority than the running one cancels the running job and
+// requeues it to start over afterwards; chunks it already streamed stay
+// in its channel.
+class InferenceService {
+public:
+  explicit InferenceService(size_t max_queued = 16);
+  ~InferenceService();
+
+  // Queue a job. If the queue is full the handle's result is immediately
+  // "[Error: Inference queue full]".
+  InferenceHandle Submit(InferenceJob job,
+                         Priority priority = Priority::Normal);
+
+  // Jobs waiting to run (not counting the running one)
+  size_t QueuedCount();
+
+  // Whether a job is running right now
+  bool IsBusy();
+
+  // Cancel everything and stop the worker. Called by the destructor.
+  void Shutdown();
+
+private:
+  struct Task {
+    InferenceJob job;
+    Priority priority = Priority::Normal;
+    uint64_t sequence = 0;
+    bool preempted = false;
+    std::shared_ptr<std::atomic<bool>> cancel;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    std::shared_ptr<TokenChannel> tokens;
+    std::shared_ptr<std::promise<std::string>> promise;
+  };
+
+  void WorkerLoop();
+  static void Finish(Task &task, const std::string &result);
+
+  size_t max_queued_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Task> queue_;
+  Task *running_ = nullptr;
+  uint64_t next_sequence_ = 0;
+  bool stopping_ = false;
+  std::thread worker_;
+};
+
+} // namespace pipeline
+} // namespace zweek
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace zweek {
+namespace pipeline {
+
+// One labelled input for training or evaluation
+struct IntentExample {
+  std::string input;
+  int label = 0; // Index into IntentClassifier::Labels()
+};
+
+// Tiny linear classifier over hashed character n-grams, distilled from the
+// router model's logged decisions. Prediction is one dot product per label
+// and runs in microseconds, so the router model is only needed when this
+// is unsure.
+class IntentClassifier {
+public:
+  static constexpr int HASH_DIM = 4096; // Hash buckets (power of two)
+
+  IntentClassifier();
+
+  // Labels in index order: "code", "chat", "tool"
+  static const std::vector<std::string> &Labels();
+  static int LabelIndex(const std::string &label); // -1 if unknown
+
+  // First label named anywhere in free-form text, ignoring case (-1 if
+  // none), for reading a label back out of generated output
+  static int FindLabel(const std::string &text);
+
+  // Probability of each label for input
+  std::vector<float> Predict(const std::string &input) const;
+
+  // Multinomial logistic regression by SGD. Weights start from zero.
+  void Train(const std::vector<IntentExample> &examples, int epochs = 20,
+             float learning_rate = 0.5f);
+
+  // Fraction of examples whose argmax matches the label
+  float Evaluate(const std::vector<IntentExample> &examples) const;
+
+  // Binary weights file. Load returns false (and leaves the classifier
+  // untrained) if the file is missing or malformed.
+  bool Load(const std::string &path);
+  bool Save(const std::string &path) const;
+
+  bool IsTrained() const { return trained_; }
+
+  // Read {"input": ..., "intent": ...} lines from a router decision log,
+  // skipping lines below min_confidence when a "confidence" is present
+  static std::vector<IntentExample>
+  ReadDecisionLog(const std::string &path, float min_confidence = 0.0f);
+
+private:
+  // L2-normalised counts of hashed 2- to 4-grams of the normalized input
+  static std::vector<std::pair<uint32_t, float>>
+  Features(const std::string &input);
+
+  std::vector<float> Scores(const std::vector<float> &dense) const;
+
+  // weights_[label * HASH_DIM + feature], bias_[label]
+  std::vector<float> weights_;
+  std::vector<float> bias_;
+  bool trained_ = false;
+};
+
+} // namespace pipeline
+} // namespace zweek
@@ -32,6 +32,12 @@ public:
   void SetResponseCallback(std::function<void(const std::string &)> callback);
   void SetStreamCallback(std::function<void(const std::string &)> callback);
   void SetDirectoryUpdateCallback(std::function<void(const std::string &)> callback);
+  void SetPrefillProgressCallback(std::function<void(int, int)> callback);
+  void SetInferenceStatsCallback(
+      std::function<void(const models::InferenceStats &)> callback);
+
+  // Stats of the last model call made for a request
+  models::InferenceStats GetLastStats() const { return last_stats_; }
 
   // Agent-specific callbacks for RLM harness
   void SetAgentThoughtCallback(std::function<void(const std::string &)> callback);
@@ -47,6 +53,9 @@ public:
   // Get command handler for external use
   commands::CommandHandler* GetCommandHandler() { return &command_handler_; }
 
+  // Requests answered by each routing tier (rules, cache, classifier, model)
+  std::string FormatRoutingStats() const;
+
 private:
   // Workflow handlers
   void RunCodePipeline(const std::string &request);
@@ -68,6 +77,8 @@ private:
   std::function<void(const std::string &)> response_callback_;
   std::function<void(const std::string &)> stream_callback_;
   std::function<void(const std::string &)> directory_update_callback_;
+  std::function<void(int, int)> prefill_progress_callback_;
+  std::function<void(const models::InferenceStats &)> inference_stats_callback_;
 
   // Agent-specific callbacks
   std::function<void(const std::string &)> agent_thought_callback_;
@@ -76,6 +87,9 @@ private:
 
   // Interrupt flag
   std::atomic<bool>* interrupt_flag_ = nullptr;
+
+  models::InferenceStats last_stats_;
+  void ReportStats(const models::InferenceStats &stats);
 };
 
 } // namespace pipeline
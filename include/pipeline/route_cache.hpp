@@ -0,0 +1,51 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace zweek {
+namespace pipeline {
+
+// On-disk LRU cache of previous routing decisions, keyed by normalized
+// input. Values are intent labels ("code", "chat", "tool").
+class RouteCache {
+public:
+  // Empty path keeps the cache in memory only
+  explicit RouteCache(const std::string &path = "", size_t capacity = 512);
+
+  // Lowercase, collapse whitespace and strip trailing punctuation so
+  // near-identical requests share an entry
+  static std::string Normalize(const std::string &input);
+
+  // Look up an input (normalized internally). Marks the entry as recently
+  // used. Returns false on a miss.
+  bool Lookup(const std::string &input, std::string &label);
+
+  // Remember a decision, evicting the least recently used entry when full.
+  // The file is rewritten after each insert.
+  void Insert(const std::string &input, const std::string &label);
+
+  size_t Size();
+
+  // Default cache file (~/.zweek/cache/routes.json)
+  static std::string GetDefaultPath();
+
+private:
+  void Load();
+  void Save();
+
+  std::string path_;
+  size_t capacity_;
+  std::mutex mutex_;
+
+  // Most recently used first
+  std::list<std::pair<std::string, std::string>> entries_;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, std::string>>::iterator>
+      index_;
+};
+
+} // namespace pipeline
+} // namespace zweek
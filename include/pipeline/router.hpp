@@ -1,6 +1,8 @@
 #pragma once
 
 #include "models/model_loader.hpp"
+#include "pipeline/intent_classifier.hpp"
+#include "pipeline/route_cache.hpp"
 #include <string>
 
 
@@ -22,6 +24,31 @@ enum class WorkflowType {
   ToolMode      // Deterministic tools
 };
 
+// Which tier of the router produced a decision
+enum class RouteSource {
+  Rule,       // Deterministic keyword rule
+  Cache,      // Previous decision for the same normalized input
+  Classifier, // Distilled n-gram classifier
+  Model,      // Router model, scored labels
+  Grammar     // Router model, grammar-constrained label (no probability)
+};
+
+// Routing decision with the model's confidence in it
+struct RouteResult {
+  Intent intent = Intent::Chat;
+  float confidence = 0.0f;     // Probability of the chosen label (0-1)
+  bool low_confidence = true;  // Below the threshold; caller should fall back
+  RouteSource source = RouteSource::Model;
+};
+
+// How often each routing tier answered
+struct RouterStats {
+  int rule_hits = 0;
+  int cache_hits = 0;
+  int classifier_hits = 0;
+  int model_calls = 0;
+};
+
 // Router classifies user intent using SmolLM-135M
 class Router {
 public:
@@ -31,6 +58,32 @@ public:
   // Classify user intent using real AI model
   Intent ClassifyIntent(const std::string &user_input);
 
+  // Classify with a confidence score. Keyword rules, the route cache and
+  // the distilled classifier (when its weights are present and it is
+  // confident) are tried first and never wake the model. Otherwise the
+  // model scores the first token of each label in one forward pass,
+  // falling back to grammar-constrained generation (which has no
+  // confidence, only a label) if the labels cannot be scored. Confident
+  // model decisions are cached.
+  RouteResult Route(const std::string &user_input);
+
+  // Minimum classifier probability to skip the router model
+  void SetClassifierThreshold(float threshold) {
+    classifier_threshold_ = threshold;
+  }
+
+  // JSONL log of router model decisions, the classifier's training data
+  // (~/.zweek/logs/router-decisions.jsonl)
+  static std::string GetDecisionLogPath();
+
+  // Hit counts for each tier since startup
+  RouterStats GetStats() const { return stats_; }
+
+  // Confidence below which a route is flagged as low confidence
+  void SetConfidenceThreshold(float threshold) {
+    confidence_threshold_ = threshold;
+  }
+
   // Get workflow for intent
   WorkflowType GetWorkflow(Intent intent);
 
@@ -41,7 +94,18 @@ public:
   void UnloadModel();
 
 private:
+  // Deterministic rules; false if none match
+  bool MatchRules(const std::string &normalized, Intent &intent);
+
+  // Append a router model decision to the decision log
+  void LogDecision(const std::string &user_input, const RouteResult &route);
+
   bool model_loaded_ = false;
+  float confidence_threshold_ = 0.6f;
+  float classifier_threshold_ = 0.85f;
+  RouteCache route_cache_{RouteCache::GetDefaultPath()};
+  IntentClassifier classifier_;
+  RouterStats stats_;
   models::ModelLoader model_loader_;
 };
 
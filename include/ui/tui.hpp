@@ -54,7 +54,10 @@ struct TUIState {
   bool in_thinking_section = true;  // Track which section we're in
   bool show_thinking = true;     // Toggle thinking visibility
   int spinner_frame = 0;         // Spinner animation frame
+  int prefill_done = 0;          // Prompt tokens decoded so far
+  int prefill_total = 0;         // Prompt tokens to decode (0 = no prefill)
   std::string current_directory; // Current working directory
+  std::string perf_status;       // Speed of the last model call (status line)
   
   // Command autocomplete
   std::vector<std::string> command_suggestions;
@@ -78,6 +81,10 @@ public:
   void AddToHistory(const std::string &message);
   void AppendToLastMessage(const std::string &chunk);
   void SetCurrentDirectory(const std::string &path);
+  void SetPrefillProgress(int done, int total);
+  // Show decode speed (and prefill speed / time to first token) of the
+  // last model call in the status line
+  void SetInferenceSpeed(double decode_tps, double prefill_tps, double ttft_ms);
 
   // Mode switching
   void SetMode(Mode mode);
@@ -88,6 +95,7 @@ public:
   void SetOnAccept(std::function<void()> callback);
   void SetOnReject(std::function<void()> callback);
   void SetOnModify(std::function<void()> callback);
+  void SetOnInterrupt(std::function<void()> callback);
   void SetOnModeSwitch(std::function<void(Mode)> callback);
   
   // Set command handler for autocomplete
@@ -115,6 +123,7 @@ private:
   std::function<void()> on_accept_;
   std::function<void()> on_reject_;
   std::function<void()> on_modify_;
+  std::function<void()> on_interrupt_;
   std::function<void(Mode)> on_mode_switch_;
   
   // Command handler for autocomplete
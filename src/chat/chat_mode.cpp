@@ -5,11 +5,20 @@
 namespace zweek {
 namespace chat {
 
-ChatMode::ChatMode() {}
+// ChatML system header that opens every chat prompt
+static const char *SYSTEM_HEADER =
+    "<|im_start|>system\n"
+    "You are a helpful coding assistant.<|im_end|>\n";
+
+ChatMode::ChatMode() { model_loader_.SetName("chat"); }
 ChatMode::~ChatMode() { UnloadModel(); }
 
 bool ChatMode::LoadModel(const std::string &model_path) {
   model_loaded_ = model_loader_.Load(model_path, 2048);
+  if (model_loaded_) {
+    // Prefill the fixed header once (or restore it from the state cache)
+    model_loader_.WarmPrefix(SYSTEM_HEADER);
+  }
   return model_loaded_;
 }
 
@@ -51,10 +60,7 @@ std::string ChatMode::Chat(const std::string &user_message,
   }
 
   // Use ChatML format for Qwen3 with thinking trigger
-  // Use ChatML format for Qwen3 with thinking trigger
-  std::string prompt = 
-    "<|im_start|>system\n"
-    "You are a helpful coding assistant.<|im_end|>\n";
+  std::string prompt = SYSTEM_HEADER;
 
   // Add history (last 10 messages to fit context)
   int start_idx = std::max(0, (int)history_.size() - 10);
@@ -69,37 +75,42 @@ std::string ChatMode::Chat(const std::string &user_message,
             "<|im_start|>assistant\n" +
             "<|im_start|>think\n";
 
-  // Increased max tokens to 2048 to prevent cutoff
-  // Wrap callback to detect stuck thinking
+  // Increased max tokens to 2048 to prevent cutoff.
+  // Cap the thinking section: stop_when runs once per generated token, so
+  // it counts tokens even though the stream arrives in batches.
   int token_count = 0;
   bool thinking_ended = false;
   const int MAX_THINKING_TOKENS = 1000;
   bool limit_exceeded = false;
 
-  auto wrapped_callback = [&](const std::string& chunk) {
+  models::InferRequest request;
+  request.prompt = prompt;
+  request.max_tokens = 2048;
+  request.stream_callback = stream_callback;
+  request.stop_when = [&](const std::string &text) {
     token_count++;
-    
-    // Check if thinking ended
-    if (!thinking_ended && chunk.find("</think>") != std::string::npos) {
+
+    // Check if thinking ended (only the tail can hold a new marker)
+    if (!thinking_ended &&
+        text.find("</think>", text.size() < 32 ? 0 : text.size() - 32) !=
+            std::string::npos) {
       thinking_ended = true;
     }
 
-    // Check limit
     if (!thinking_ended && token_count > MAX_THINKING_TOKENS) {
       limit_exceeded = true;
-      if (interrupt_flag) *interrupt_flag = true;
-      stream_callback("\n</think>\n[Error: Thinking limit exceeded]");
-      return;
+      return true;
     }
-
-    stream_callback(chunk);
+    return false;
   };
 
-  std::string response = model_loader_.Infer(prompt, "", 2048, wrapped_callback, interrupt_flag);
+  std::string response = model_loader_.Infer(request, interrupt_flag);
 
   // If limit exceeded, ensure we close the tag in the final response so TUI parses it
   if (limit_exceeded && response.find("</think>") == std::string::npos) {
-      response += "\n</think>\n[Error: Thinking limit exceeded]";
+      const std::string limit_message = "\n</think>\n[Error: Thinking limit exceeded]";
+      stream_callback(limit_message);
+      response += limit_message;
   }
 
   // Check if we have an answer after </think>
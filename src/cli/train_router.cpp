@@ -0,0 +1,125 @@
+// Train and evaluate the distilled intent classifier from router decisions.
+//
+//   zweek_train_router train <decisions.jsonl> <weights.bin> [options]
+//   zweek_train_router eval  <decisions.jsonl> <weights.bin> [options]
+//
+// Options:
+//   --epochs N            SGD epochs (default 20)
+//   --min-confidence X    Skip logged decisions below X (default 0.6)
+//
+// The decision log is written by the router to
+// ~/.zweek/logs/router-decisions.jsonl.
+
+#include "pipeline/intent_classifier.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace zweek::pipeline;
+
+namespace {
+
+int Usage() {
+  std::cerr << "Usage: zweek_train_router train|eval <decisions.jsonl> "
+               "<weights.bin> [--epochs N] [--min-confidence X]"
+            << std::endl;
+  return 1;
+}
+
+void PrintLabelCounts(const std::vector<IntentExample> &examples) {
+  std::vector<int> counts(IntentClassifier::Labels().size(), 0);
+  for (const auto &ex : examples) {
+    ++counts[ex.label];
+  }
+  for (size_t i = 0; i < counts.size(); ++i) {
+    std::cout << "  " << IntentClassifier::Labels()[i] << ": " << counts[i]
+              << std::endl;
+  }
+}
+
+// Mean prediction time in microseconds
+double TimePredict(const IntentClassifier &classifier,
+                   const std::vector<IntentExample> &examples) {
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &ex : examples) {
+    classifier.Predict(ex.input);
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start);
+  return elapsed.count() / examples.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    return Usage();
+  }
+
+  std::string mode = argv[1];
+  std::string log_path = argv[2];
+  std::string weights_path = argv[3];
+  int epochs = 20;
+  float min_confidence = 0.6f;
+
+  for (int i = 4; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--epochs" && i + 1 < argc) {
+      epochs = std::atoi(argv[++i]);
+    } else if (arg == "--min-confidence" && i + 1 < argc) {
+      min_confidence = std::atof(argv[++i]);
+    } else {
+      return Usage();
+    }
+  }
+
+  std::vector<IntentExample> examples =
+      IntentClassifier::ReadDecisionLog(log_path, min_confidence);
+  if (examples.empty()) {
+    std::cerr << "No usable decisions in " << log_path << std::endl;
+    return 1;
+  }
+  std::cout << examples.size() << " decisions" << std::endl;
+  PrintLabelCounts(examples);
+
+  IntentClassifier classifier;
+
+  if (mode == "train") {
+    // Every 10th decision is held out to report accuracy
+    std::vector<IntentExample> train, held_out;
+    for (size_t i = 0; i < examples.size(); ++i) {
+      (i % 10 == 9 ? held_out : train).push_back(examples[i]);
+    }
+    if (!held_out.empty()) {
+      classifier.Train(train, epochs);
+      std::cout << "Held-out accuracy: "
+                << classifier.Evaluate(held_out) * 100 << "% ("
+                << held_out.size() << " decisions)" << std::endl;
+    }
+
+    // Ship weights trained on everything
+    classifier.Train(examples, epochs);
+    std::cout << "Training accuracy: " << classifier.Evaluate(examples) * 100
+              << "%" << std::endl;
+
+    if (!classifier.Save(weights_path)) {
+      std::cerr << "Failed to write " << weights_path << std::endl;
+      return 1;
+    }
+    std::cout << "Wrote " << weights_path << std::endl;
+  } else if (mode == "eval") {
+    if (!classifier.Load(weights_path)) {
+      std::cerr << "Failed to load " << weights_path << std::endl;
+      return 1;
+    }
+    std::cout << "Accuracy: " << classifier.Evaluate(examples) * 100 << "%"
+              << std::endl;
+  } else {
+    return Usage();
+  }
+
+  std::cout << "Prediction time: " << TimePredict(classifier, examples)
+            << " us" << std::endl;
+  return 0;
+}
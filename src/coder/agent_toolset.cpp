@@ -1,8 +1,18 @@
 #include "coder/agent_toolset.hpp"
 #include <fstream>
+#include <future>
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
 
 namespace zweek {
 namespace coder {
@@ -314,6 +324,130 @@ ToolResult AgentToolSet::ListDir(const std::string& path) {
     return result;
 }
 
+// Run git with the given arguments and collect its combined stdout and
+// stderr, keeping at most max_lines lines. Returns git's exit status, or -1
+// if it could not be started. On POSIX the arguments go straight to the
+// process, never through a shell.
+static int RunGit(const std::vector<std::string>& args, int max_lines,
+                  std::string& output, int& line_count) {
+    FILE* pipe = nullptr;
+#ifdef _WIN32
+    // _popen always goes through cmd.exe: refuse anything it would interpret
+    std::string command = "git";
+    for (const auto& arg : args) {
+        if (arg.find_first_of("\"%^&|<>!") != std::string::npos) {
+            return -1;
+        }
+        command += " \"" + arg + "\"";
+    }
+    command += " 2>&1";
+    pipe = _popen(command.c_str(), "r");
+#else
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        return -1;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>("git"));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    int spawned = posix_spawnp(&pid, "git", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (spawned != 0) {
+        close(fds[0]);
+        return -1;
+    }
+    pipe = fdopen(fds[0], "r");
+    if (!pipe) {
+        close(fds[0]);
+        waitpid(pid, nullptr, 0);
+        return -1;
+    }
+#endif
+    if (!pipe) {
+        return -1;
+    }
+
+    char buffer[4096];
+    bool capped = false;
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        size_t len = std::strlen(buffer);
+        if (len > 0 && buffer[len - 1] == '\n' && ++line_count > max_lines) {
+            capped = true;
+        }
+        if (!capped) {
+            output.append(buffer, len);  // Keep draining so git can exit
+        }
+    }
+
+#ifdef _WIN32
+    return _pclose(pipe);
+#else
+    fclose(pipe);
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+#endif
+}
+
+ToolResult AgentToolSet::GitDiff(const std::string& path) {
+    ToolResult result;
+
+    // Only plain paths: no options, globs or pathspec magic
+    bool plain = !path.empty() && std::all_of(path.begin(), path.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '/' ||
+               c == '.' || c == '_' || c == '-';
+    });
+    if (!plain) {
+        result.error = "Invalid path for GIT_DIFF: " + path;
+        return result;
+    }
+
+    auto resolved = ResolvePath(path);
+    if (!IsPathSafe(resolved)) {
+        result.error = "Path outside working directory.";
+        return result;
+    }
+
+    std::string output;
+    int line_count = 0;
+    int status = RunGit({"-C", working_dir_, "diff", "--no-color", "--", path},
+                        MAX_DIFF_LINES, output, line_count);
+    if (status < 0) {
+        result.error = "Failed to run git.";
+        return result;
+    }
+    result.truncated = line_count > MAX_DIFF_LINES;
+
+    if (status != 0) {
+        result.error = "git diff failed: " + output.substr(0, output.find('\n'));
+        return result;
+    }
+
+    result.success = true;
+    result.lines_returned = std::min(line_count, MAX_DIFF_LINES);
+    result.output = output.empty() ? "[No uncommitted changes]\n" : output;
+    if (result.truncated) {
+        result.output += "[Diff truncated at " + std::to_string(MAX_DIFF_LINES) +
+                         " lines]\n";
+    }
+    return result;
+}
+
 ToolResult AgentToolSet::FileInfo(const std::string& path) {
     ToolResult result;
 
@@ -576,6 +710,104 @@ ToolResult AgentToolSet::Finish(const std::string& summary) {
     return result;
 }
 
+std::vector<ToolResult> AgentToolSet::ExecuteBatch(
+        const std::vector<std::string>& commands) {
+    std::vector<ToolResult> results(commands.size());
+
+    size_t i = 0;
+    bool finished = false;
+    while (i < commands.size() && !finished) {
+        if ((int)i >= MAX_BATCH_COMMANDS) {
+            results[i++].error = "Too many commands in one step. Maximum is " +
+                                 std::to_string(MAX_BATCH_COMMANDS) + ".";
+            continue;
+        }
+
+        // A run of reads can't affect each other, so run them together
+        size_t end = i;
+        while (end < commands.size() && (int)end < MAX_BATCH_COMMANDS &&
+               IsReadOnly(commands[end])) {
+            ++end;
+        }
+        if (end - i > 1) {
+            std::vector<std::future<ToolResult>> pending;
+            for (size_t j = i; j < end; ++j) {
+                pending.push_back(std::async(std::launch::async,
+                                             [this, &commands, j]() {
+                                                 return Execute(commands[j]);
+                                             }));
+            }
+            for (size_t j = i; j < end; ++j) {
+                results[j] = pending[j - i].get();
+            }
+            i = end;
+            continue;
+        }
+
+        results[i] = Execute(commands[i]);
+        finished = results[i].finished;
+        ++i;
+    }
+
+    for (; i < commands.size(); ++i) {
+        results[i].error = "Not run: the task already finished.";
+    }
+    return results;
+}
+
+ToolResult AgentToolSet::MergeResults(const std::vector<std::string>& commands,
+                                      const std::vector<ToolResult>& results) {
+    if (results.size() == 1) {
+        return results[0];
+    }
+
+    ToolResult merged;
+    merged.success = !results.empty();
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ToolResult& result = results[i];
+        std::string header = i < commands.size()
+                                 ? commands[i].substr(0, commands[i].find('\n'))
+                                 : std::to_string(i + 1);
+
+        merged.success = merged.success && result.success;
+        merged.lines_returned += result.lines_returned;
+        merged.truncated = merged.truncated || result.truncated;
+        if (result.finished) {
+            merged.finished = true;
+        }
+
+        if (result.success) {
+            merged.output += "[" + header + "]\n" + result.output;
+            if (!result.output.empty() && result.output.back() != '\n') {
+                merged.output += "\n";
+            }
+        } else {
+            merged.output += "[" + header + "]\nERROR: " + result.error + "\n";
+            if (!merged.error.empty()) {
+                merged.error += "\n";
+            }
+            merged.error += header + ": " + result.error;
+        }
+    }
+    return merged;
+}
+
+bool AgentToolSet::IsReadOnly(const std::string& command) {
+    size_t start = command.find_first_not_of(" \t\n\r");
+    if (start == std::string::npos) {
+        return false;
+    }
+    size_t end = command.find_first_of(" \t\n\r", start);
+    std::string cmd_type = command.substr(start, end == std::string::npos
+                                                     ? std::string::npos
+                                                     : end - start);
+    std::transform(cmd_type.begin(), cmd_type.end(), cmd_type.begin(), ::toupper);
+
+    return cmd_type == "READ_LINES" || cmd_type == "GREP" ||
+           cmd_type == "LIST" || cmd_type == "FILE_INFO" ||
+           cmd_type == "GIT_DIFF";
+}
+
 ToolResult AgentToolSet::Execute(const std::string& command) {
     ToolResult result;
 
@@ -641,6 +873,14 @@ ToolResult AgentToolSet::Execute(const std::string& command) {
         }
         return FileInfo(path);
     }
+    else if (cmd_type == "GIT_DIFF") {
+        std::string path = args.empty() ? "." : args;
+        size_t end = path.find_last_not_of(" \t\n\r");
+        if (end != std::string::npos) {
+            path = path.substr(0, end + 1);
+        }
+        return GitDiff(path);
+    }
     else if (cmd_type == "CREATE") {
         std::string path = args;
         size_t end = path.find_last_not_of(" \t\n\r");
@@ -733,7 +973,7 @@ ToolResult AgentToolSet::Execute(const std::string& command) {
     }
     else {
         result.error = "Unknown command: " + cmd_type + "\n"
-                       "Available: READ_LINES, GREP, LIST, FILE_INFO, WRITE, INSERT, DELETE_LINES, CREATE, FINISH";
+                       "Available: READ_LINES, GREP, LIST, FILE_INFO, GIT_DIFF, WRITE, INSERT, DELETE_LINES, CREATE, FINISH";
         return result;
     }
 }
@@ -0,0 +1,100 @@
+#include "coder/command_stream_parser.hpp"
+#include <algorithm>
+
+namespace zweek {
+namespace coder {
+
+namespace {
+
+const std::string CMD_PREFIX = "CMD: ";
+
+// Resume a search for needle so that a match split across feeds is found
+size_t ResumeAt(size_t size, size_t from, const std::string& needle) {
+    return std::max(from, size >= needle.size() ? size - needle.size() + 1 : 0);
+}
+
+}  // namespace
+
+CommandStreamParser::CommandStreamParser(size_t max_commands)
+    : max_commands_(std::max<size_t>(1, max_commands)) {}
+
+bool CommandStreamParser::Feed(std::string_view text) {
+    if (complete_) {
+        return true;
+    }
+    buffer_ += text;
+
+    while (ParseCommand()) {
+        const std::string& command = commands_.back();
+        if (commands_.size() >= max_commands_ ||
+            command.compare(0, 7, "FINISH ") == 0) {
+            complete_ = true;
+            break;
+        }
+    }
+    return complete_;
+}
+
+bool CommandStreamParser::ParseCommand() {
+    if (cmd_start_ == std::string::npos) {
+        size_t pos = buffer_.find(CMD_PREFIX, scan_);
+        if (pos == std::string::npos) {
+            scan_ = ResumeAt(buffer_.size(), scan_, CMD_PREFIX);
+            return false;
+        }
+        cmd_start_ = pos + CMD_PREFIX.size();
+        scan_ = cmd_start_;
+    }
+
+    if (line_end_ == std::string::npos) {
+        size_t newline = buffer_.find('\n', scan_);
+        if (newline == std::string::npos) {
+            scan_ = buffer_.size();
+            return false;
+        }
+        line_end_ = newline;
+        scan_ = newline + 1;
+
+        size_t verb_end = std::min(buffer_.find(' ', cmd_start_), newline);
+        std::string verb = buffer_.substr(cmd_start_, verb_end - cmd_start_);
+        if (verb == "WRITE" || verb == "INSERT") {
+            end_marker_ = "END_" + verb;
+        }
+    }
+
+    size_t end = line_end_;
+    if (!end_marker_.empty()) {
+        size_t marker = buffer_.find(end_marker_, scan_);
+        if (marker == std::string::npos) {
+            scan_ = ResumeAt(buffer_.size(), scan_, end_marker_);
+            return false;
+        }
+        scan_ = marker;
+        end = buffer_.find('\n', marker + end_marker_.size());
+        if (end == std::string::npos) {
+            return false;
+        }
+    }
+
+    commands_.push_back(buffer_.substr(cmd_start_, end + 1 - cmd_start_));
+
+    // The next command starts after this one
+    scan_ = end + 1;
+    cmd_start_ = std::string::npos;
+    line_end_ = std::string::npos;
+    end_marker_.clear();
+    return true;
+}
+
+void CommandStreamParser::Reset() {
+    buffer_.clear();
+    scan_ = 0;
+    cmd_start_ = std::string::npos;
+    line_end_ = std::string::npos;
+    end_marker_.clear();
+    commands_.clear();
+    complete_ = false;
+}
+
+}  // namespace coder
+}  // namespace zweek
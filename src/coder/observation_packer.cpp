@@ -0,0 +1,86 @@
+#include "coder/observation_packer.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace zweek {
+namespace coder {
+
+ObservationPacker::ObservationPacker(TokenCounter count_tokens)
+    : count_tokens_(std::move(count_tokens)) {}
+
+int ObservationPacker::LineTokens(const std::string& line) const {
+    auto it = cache_.find(line);
+    if (it != cache_.end()) {
+        return it->second;
+    }
+    if (cache_.size() >= MAX_CACHED_LINES) {
+        cache_.clear();
+    }
+    int tokens = count_tokens_(line + "\n");
+    cache_.emplace(line, tokens);
+    return tokens;
+}
+
+PackedObservation ObservationPacker::Pack(
+        const std::string& output, int budget, const Marker& marker) const {
+    PackedObservation packed;
+
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) {
+            end = output.size();
+        }
+        lines.push_back(output.substr(start, end - start));
+        start = end + 1;
+    }
+    packed.total_lines = static_cast<int>(lines.size());
+
+    std::vector<int> counts;
+    counts.reserve(lines.size());
+    int total = 0;
+    for (const auto& line : lines) {
+        counts.push_back(LineTokens(line));
+        total += counts.back();
+    }
+
+    if (total <= budget) {
+        packed.text = output;
+        packed.tokens = total;
+        return packed;
+    }
+
+    // The marker's length barely depends on the range, so size it once
+    const int n = packed.total_lines;
+    const int marker_tokens = count_tokens_(marker(1, n, n) + "\n");
+    const int available = std::max(0, budget - marker_tokens);
+
+    // Most of the budget goes to the head (where a listing or a read
+    // range starts); the tail shows where the output ended
+    int head = 0;
+    int used = 0;
+    while (head < n && used + counts[head] <= available * 3 / 4) {
+        used += counts[head++];
+    }
+    int tail = n;
+    while (tail - 1 > head && used + counts[tail - 1] <= available) {
+        used += counts[--tail];
+    }
+
+    packed.elided_first = head + 1;
+    packed.elided_last = tail;
+    for (int i = 0; i < head; ++i) {
+        packed.text += lines[i] + "\n";
+    }
+    std::string mark = marker(packed.elided_first, packed.elided_last, n) + "\n";
+    packed.text += mark;
+    for (int i = tail; i < n; ++i) {
+        packed.text += lines[i] + "\n";
+    }
+    packed.tokens = used + count_tokens_(mark);
+    return packed;
+}
+
+}  // namespace coder
+}  // namespace zweek
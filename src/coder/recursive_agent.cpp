@@ -1,6 +1,14 @@
 #include "coder/recursive_agent.hpp"
+#include "coder/command_stream_parser.hpp"
+#include "coder/tool_plan.hpp"
+#include "pipeline/grammars.hpp"
 #include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <nlohmann/json.hpp>
 
 namespace zweek {
 namespace coder {
@@ -19,30 +27,89 @@ const char* RecursiveAgent::GetSystemPrompt() {
            "RULES:\n"
            "1. Only use commands listed above\n"
            "2. FINISH must include the actual answer with details\n"
-           "3. Do NOT create or modify files unless explicitly asked";
+           "3. Do NOT create or modify files unless explicitly asked\n"
+           "4. To look at several things at once, write up to 4 CMD lines after one THOUGHT";
 }
 
-// GBNF grammar for constrained generation
+// GBNF grammar for constrained generation. A step may hold up to
+// AgentToolSet::MAX_BATCH_COMMANDS commands.
 const char* RecursiveAgent::GetAgentGrammar() {
-    return
-        "root ::= thought command\n"
-        "thought ::= \"THOUGHT: \" thought-text \"\\n\"\n"
-        "thought-text ::= [^\\n]+\n"
-        "command ::= \"CMD: \" cmd-body\n"
-        "cmd-body ::= read-cmd | grep-cmd | list-cmd | finish-cmd\n"
-        "read-cmd ::= \"READ_LINES \" path \" \" line-range \"\\n\"\n"
-        "grep-cmd ::= \"GREP \" pattern \" \" path \"\\n\"\n"
-        "list-cmd ::= \"LIST \" path \"\\n\"\n"
-        "finish-cmd ::= \"FINISH \" [^\\n]+ \"\\n\"\n"
-        "line-range ::= number \"-\" number\n"
-        "number ::= [0-9]+\n"
-        "path ::= [a-zA-Z0-9_./-]+\n"
-        "pattern ::= [a-zA-Z0-9_.*?]+";
+    return grammars::AGENT_GRAMMAR;
+}
+
+std::string GetDefaultConfigPath() {
+#ifdef _WIN32
+    const char* home = getenv("USERPROFILE");
+    if (home) {
+        return std::string(home) + "\\.zweek\\config.json";
+    }
+#else
+    const char* home = getenv("HOME");
+    if (home) {
+        return std::string(home) + "/.zweek/config.json";
+    }
+#endif
+    return "";
+}
+
+bool LoadAgentConfigFile(const std::string& path, AgentConfig& config) {
+    if (path.empty() || !std::filesystem::exists(path)) {
+        return true;
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open config: " << path << std::endl;
+        return false;
+    }
+
+    try {
+        nlohmann::json root;
+        file >> root;
+
+        const nlohmann::json agent = root.value("agent", nlohmann::json::object());
+        config.model_path = agent.value("model_path", config.model_path);
+        config.max_steps = agent.value("max_steps", config.max_steps);
+        config.max_tokens_per_step =
+            agent.value("max_tokens_per_step", config.max_tokens_per_step);
+        config.context_window = agent.value("context_window", config.context_window);
+        config.history_window = agent.value("history_window", config.history_window);
+        config.max_plan_lookups =
+            agent.value("max_plan_lookups", config.max_plan_lookups);
+        config.draft_model_path =
+            agent.value("draft_model_path", config.draft_model_path);
+
+        const nlohmann::json kv = agent.value("kv_cache", nlohmann::json::object());
+        config.kv_cache.type_k = kv.value("type_k", config.kv_cache.type_k);
+        config.kv_cache.type_v = kv.value("type_v", config.kv_cache.type_v);
+        config.kv_cache.flash_attn =
+            kv.value("flash_attn", config.kv_cache.flash_attn);
+
+        const nlohmann::json threads = agent.value("threads", nlohmann::json::object());
+        config.threads.n_threads_decode =
+            threads.value("decode", config.threads.n_threads_decode);
+        config.threads.n_threads_prefill =
+            threads.value("prefill", config.threads.n_threads_prefill);
+        config.threads.pin_threads = threads.value("pin", config.threads.pin_threads);
+        config.threads.calibrate =
+            threads.value("calibrate", config.threads.calibrate);
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Invalid config " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
 }
 
 RecursiveAgent::RecursiveAgent(const AgentConfig& config)
     : config_(config)
-    , toolset_(".") {
+    , toolset_(".")
+    , packer_([this](const std::string& text) { return model_.CountTokens(text); }) {
+    model_.SetName("agent");
+    model_.SetPrefillProgressCallback([this](int done, int total) {
+        if (callbacks_.on_prefill_progress) {
+            callbacks_.on_prefill_progress(done, total);
+        }
+    });
 }
 
 RecursiveAgent::~RecursiveAgent() {
@@ -52,6 +119,11 @@ RecursiveAgent::~RecursiveAgent() {
 bool RecursiveAgent::Init() {
     ReportProgress("Loading model: " + config_.model_path);
 
+    model_.SetThreadConfig(config_.threads);
+    if (!model_.SetKvCacheConfig(config_.kv_cache)) {
+        ReportProgress("Unknown KV cache type " + config_.kv_cache.type_k +
+                       "/" + config_.kv_cache.type_v + ", using f16");
+    }
     if (!model_.Load(config_.model_path, config_.context_window)) {
         if (callbacks_.on_error) {
             callbacks_.on_error("Failed to load model: " + config_.model_path);
@@ -60,6 +132,15 @@ bool RecursiveAgent::Init() {
         return false;
     }
 
+    // Small draft model speeds up decoding; falls back silently if missing
+    if (!config_.draft_model_path.empty()) {
+        model_.EnableSpeculativeDecoding(config_.draft_model_path);
+    }
+
+    // The system prompt opens every step's prompt; prefill it once (or
+    // restore it from the on-disk state cache)
+    model_.WarmPrefix(std::string(GetSystemPrompt()) + "\n\n");
+
     ReportProgress("Model loaded successfully");
     return true;
 }
@@ -71,11 +152,23 @@ void RecursiveAgent::StartTask(const std::string& task_description,
     toolset_.SetWorkingDirectory(working_directory);
     state_ = AgentState::Ready;
 
+    // Starts with the warmed system prompt, so its KV entries are reused
+    transcript_header_ = std::string(GetSystemPrompt()) + "\n\n" +
+                         "TASK: " + current_task_ + "\n" +
+                         "DIR: " + toolset_.GetWorkingDirectory() + "\n\n";
+    transcript_header_tokens_ = model_.CountTokens(transcript_header_);
+
     ReportProgress("Starting task in: " + working_directory);
 }
 
 void RecursiveAgent::Reset() {
     history_.clear();
+    transcript_.clear();
+    transcript_header_.clear();
+    transcript_header_tokens_ = 0;
+    summary_lines_.clear();
+    summary_text_.clear();
+    summary_tokens_ = 0;
     step_count_ = 0;
     current_task_.clear();
     final_summary_.clear();
@@ -84,6 +177,101 @@ void RecursiveAgent::Reset() {
 
 void RecursiveAgent::Unload() {
     model_.Unload();
+    packer_.ClearCache();
+}
+
+bool RecursiveAgent::PlanTask(std::atomic<bool>* interrupt_flag) {
+    if (current_task_.empty() || !transcript_.empty() ||
+        config_.max_plan_lookups <= 0 || state_ != AgentState::Ready) {
+        return false;
+    }
+    ReportProgress("Planning lookups");
+
+    // The plan is quoted in the transcript like a step, so the first
+    // step's prompt extends this one
+    const std::string plan_prompt =
+        "PLAN (JSON): files to read (read_file), searches (search, with a "
+        "pattern), uncommitted changes to check (git_diff) and files that "
+        "will need changes (write_file)\n";
+
+    state_ = AgentState::Thinking;
+    models::InferRequest request;
+    request.prompt = BuildPrompt() + plan_prompt;
+    request.grammar = grammars::PLANNER_GRAMMAR;
+    request.max_tokens = config_.max_tokens_per_step;
+    request.stream_callback = [this](const std::string& token) {
+        if (callbacks_.on_stream) {
+            callbacks_.on_stream(token);
+        }
+    };
+    // Paths and patterns can't hold a bracket, so the first ']' closes the
+    // plan; don't let trailing whitespace run on to max_tokens
+    request.stop_when = [](const std::string& output) {
+        return output.find(']') != std::string::npos;
+    };
+    std::string plan = model_.Infer(request, interrupt_flag);
+
+    if (callbacks_.on_inference_stats) {
+        callbacks_.on_inference_stats(model_.GetLastStats());
+    }
+
+    if (interrupt_flag && interrupt_flag->load()) {
+        state_ = AgentState::Interrupted;
+        return false;
+    }
+    state_ = AgentState::Ready;
+
+    std::vector<PlanStep> steps;
+    if (!ParseToolPlan(plan, steps) || steps.empty()) {
+        ReportProgress("No usable plan, continuing step by step");
+        return false;
+    }
+
+    std::vector<std::string> commands, edit_targets;
+    state_ = AgentState::Executing;
+    std::vector<ToolResult> results = RunToolPlan(
+        toolset_, steps, config_.max_plan_lookups, commands, edit_targets);
+    state_ = AgentState::Ready;
+    if (commands.empty() && edit_targets.empty()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        if (callbacks_.on_command) {
+            callbacks_.on_command(commands[i]);
+        }
+        if (callbacks_.on_tool_result) {
+            callbacks_.on_tool_result(results[i]);
+        }
+    }
+
+    std::string output = plan_prompt + plan;
+    if (output.back() != '\n') {
+        output += "\n";
+    }
+    if (!edit_targets.empty()) {
+        output += "FILES TO CHANGE:";
+        for (const auto& path : edit_targets) {
+            output += " " + path;
+        }
+        output += "\n";
+    }
+
+    AgentStep step;
+    step.observation = "Working directory: " + toolset_.GetWorkingDirectory() +
+                       "\nTask: " + current_task_;
+    step.thought = "Plan";
+    for (const auto& cmd : commands) {
+        step.command += cmd;
+    }
+    step.result = AgentToolSet::MergeResults(commands, results);
+    history_.push_back(step);
+
+    AppendToTranscript(output, commands, results);
+    CompactTranscript();
+
+    ReportProgress("Plan ran " + std::to_string(commands.size()) + " lookups");
+    return true;
 }
 
 std::string RecursiveAgent::Run(std::atomic<bool>* interrupt_flag) {
@@ -147,18 +335,43 @@ bool RecursiveAgent::Step(std::atomic<bool>* interrupt_flag) {
     state_ = AgentState::Thinking;
     std::string prompt = BuildPrompt();
 
-    // Run inference with grammar constraint
-    std::string model_output = model_.Infer(
-        prompt,
-        GetAgentGrammar(),
-        config_.max_tokens_per_step,
-        [this](const std::string& token) {
-            if (callbacks_.on_stream) {
-                callbacks_.on_stream(token);
+    // Run inference with grammar constraint, stopping as soon as the
+    // batch is complete rather than waiting for the grammar to end. The
+    // read-only commands that open a batch start running as soon as their
+    // line is complete, while the model writes the rest.
+    CommandStreamParser parser(AgentToolSet::MAX_BATCH_COMMANDS);
+    std::vector<std::future<ToolResult>> prefetched;
+    bool prefetching = true;
+    models::InferRequest request;
+    request.prompt = prompt;
+    request.grammar = GetAgentGrammar();
+    request.max_tokens = config_.max_tokens_per_step;
+    request.stream_callback = [this](const std::string& token) {
+        if (callbacks_.on_stream) {
+            callbacks_.on_stream(token);
+        }
+    };
+    request.stop_when = [&](const std::string& output) {
+        bool done = parser.Feed(std::string_view(output).substr(parser.Size()));
+        const auto& commands = parser.Commands();
+        while (prefetching && prefetched.size() < commands.size()) {
+            const std::string& command = commands[prefetched.size()];
+            if (!AgentToolSet::IsReadOnly(command)) {
+                prefetching = false;  // Later reads may depend on this one
+                break;
             }
-        },
-        interrupt_flag
-    );
+            prefetched.push_back(std::async(std::launch::async,
+                                            [this, command]() {
+                                                return toolset_.Execute(command);
+                                            }));
+        }
+        return done;
+    };
+    std::string model_output = model_.Infer(request, interrupt_flag);
+
+    if (callbacks_.on_inference_stats) {
+        callbacks_.on_inference_stats(model_.GetLastStats());
+    }
 
     if (interrupt_flag && interrupt_flag->load()) {
         state_ = AgentState::Interrupted;
@@ -175,31 +388,50 @@ bool RecursiveAgent::Step(std::atomic<bool>* interrupt_flag) {
         state_ = AgentState::Error;
         return false;
     }
+    // The parser's commands end where each command does, even if a token
+    // ran past it; it has none if generation ended mid-line
+    std::vector<std::string> commands = parser.Commands();
+    if (commands.empty()) {
+        commands.push_back(command);
+    }
 
     // Report thought
     if (callbacks_.on_thought) {
         callbacks_.on_thought(thought);
     }
 
-    // Report command
+    // Report commands
     if (callbacks_.on_command) {
-        callbacks_.on_command(command);
+        for (const auto& cmd : commands) {
+            callbacks_.on_command(cmd);
+        }
     }
 
-    // Execute command
+    // Execute the commands not already started
     state_ = AgentState::Executing;
-    ToolResult result = toolset_.Execute(command);
+    std::vector<ToolResult> results;
+    for (auto& pending : prefetched) {
+        results.push_back(pending.get());
+    }
+    std::vector<std::string> rest(commands.begin() + results.size(), commands.end());
+    for (auto& result : toolset_.ExecuteBatch(rest)) {
+        results.push_back(std::move(result));
+    }
 
-    // Report result
+    // Report results
     if (callbacks_.on_tool_result) {
-        callbacks_.on_tool_result(result);
+        for (const auto& result : results) {
+            callbacks_.on_tool_result(result);
+        }
     }
 
     // Record step in history
     AgentStep step;
     step.thought = thought;
-    step.command = command;
-    step.result = result;
+    for (const auto& cmd : commands) {
+        step.command += cmd;
+    }
+    step.result = AgentToolSet::MergeResults(commands, results);
 
     // Observation is the result of the previous step (or initial state for first step)
     if (history_.empty()) {
@@ -212,12 +444,16 @@ bool RecursiveAgent::Step(std::atomic<bool>* interrupt_flag) {
     }
 
     history_.push_back(step);
+    AppendToTranscript(model_output, commands, results);
+    CompactTranscript();
 
     // Check if finished
-    if (result.finished) {
-        state_ = AgentState::Finished;
-        final_summary_ = result.output;
-        return false;  // No more steps needed
+    for (const auto& result : results) {
+        if (result.finished) {
+            state_ = AgentState::Finished;
+            final_summary_ = result.output;
+            return false;  // No more steps needed
+        }
     }
 
     state_ = AgentState::Ready;
@@ -230,36 +466,164 @@ static std::string Truncate(const std::string& s, size_t max_len) {
     return s.substr(0, max_len) + "...[truncated]";
 }
 
+// The line that stands in for elided tool output. READ_LINES output has
+// one line per file line, so the marker names the exact READ_LINES
+// command that pages the missing range back in.
+static std::string ElisionMarker(const std::string& command, int first, int last,
+                                 int total) {
+    std::istringstream in(command.substr(0, command.find('\n')));
+    std::string verb, path, range;
+    in >> verb >> path >> range;
+
+    int range_start = 0;
+    if (verb == "READ_LINES" && range.find('-') != std::string::npos) {
+        range_start = std::atoi(range.c_str());
+    }
+    if (range_start > 0) {
+        int file_first = range_start + first - 1;
+        int file_last = range_start + last - 1;
+        return "[... lines " + std::to_string(file_first) + "-" +
+               std::to_string(file_last) + " elided; READ_LINES " + path + " " +
+               std::to_string(file_first) + "-" + std::to_string(file_last) +
+               " to see them]";
+    }
+    return "[... output lines " + std::to_string(first) + "-" +
+           std::to_string(last) + " of " + std::to_string(total) +
+           " elided; narrow the command to see them]";
+}
+
 std::string RecursiveAgent::BuildPrompt() const {
-    std::stringstream ss;
+    std::string prompt = transcript_header_ + summary_text_;
+    for (const auto& entry : transcript_) {
+        prompt += entry.text;
+    }
+    return prompt;
+}
 
-    // Compact system prompt
-    ss << GetSystemPrompt() << "\n\n";
+void RecursiveAgent::AppendToTranscript(const std::string& model_output,
+                                        const std::vector<std::string>& commands,
+                                        const std::vector<ToolResult>& results) {
+    TranscriptEntry entry;
 
-    // Task
-    ss << "TASK: " << current_task_ << "\n";
-    ss << "DIR: " << toolset_.GetWorkingDirectory() << "\n\n";
+    // Quote the output exactly as generated so the next prompt extends
+    // the tokens already in the KV cache
+    entry.text = model_output;
+    if (entry.text.empty() || entry.text.back() != '\n') {
+        entry.text += "\n";
+    }
+    entry.text += "RESULT:\n";
+    entry.tokens = model_.CountTokens(entry.text);
+
+    // A batch shares one observation budget, each result under its command
+    const size_t n = std::min(commands.size(), results.size());
+    const int budget = ObservationBudget(entry.tokens) / std::max<int>(1, n);
+    for (size_t i = 0; i < n; ++i) {
+        const std::string& command = commands[i];
+        const ToolResult& result = results[i];
+        std::string first_line = command.substr(0, command.find('\n'));
+        if (n > 1) {
+            entry.text += "[" + first_line + "]\n";
+            entry.tokens += model_.CountTokens("[" + first_line + "]\n");
+        }
 
-    if (history_.empty()) {
-        // First step - no history yet
-        ss << "Begin by exploring. What is your first action?\n\n";
-        ss << "THOUGHT:";
-    } else {
-        // Show what just happened
-        const auto& last = history_.back();
-        ss << "YOUR LAST ACTION:\n";
-        ss << "CMD: " << last.command << "\n";
-        ss << "RESULT:\n";
-        if (last.result.success) {
-            ss << Truncate(last.result.output, 1000) << "\n";
+        if (result.success) {
+            PackedObservation packed = packer_.Pack(
+                result.output, budget,
+                [&command](int first, int last, int total) {
+                    return ElisionMarker(command, first, last, total);
+                });
+            entry.text += packed.text;
+            if (!packed.text.empty() && packed.text.back() != '\n') {
+                entry.text += "\n";
+            }
+            entry.tokens += packed.tokens;
+
+            entry.summary_line += "- " + first_line + " -> ok, " +
+                                  std::to_string(packed.total_lines) + " lines";
+            if (packed.Elided()) {
+                entry.summary_line += " (" + std::to_string(packed.elided_last -
+                                                            packed.elided_first + 1) +
+                                      " elided)";
+            }
+            entry.summary_line += "\n";
         } else {
-            ss << "ERROR: " << last.result.error << "\n";
+            entry.text += "ERROR: " + result.error + "\n";
+            entry.tokens += model_.CountTokens("ERROR: " + result.error + "\n");
+            entry.summary_line += "- " + first_line + " -> ERROR: " +
+                                  Truncate(result.error, 80) + "\n";
         }
-        ss << "\nBased on this result, what is your NEXT action? (Use FINISH if done)\n\n";
-        ss << "THOUGHT:";
     }
+    entry.text += "\n";
+    entry.tokens += 1;
+
+    transcript_.push_back(entry);
+}
+
+int RecursiveAgent::TranscriptTokens() const {
+    int tokens = transcript_header_tokens_ + summary_tokens_;
+    for (const auto& entry : transcript_) {
+        tokens += entry.tokens;
+    }
+    return tokens;
+}
+
+int RecursiveAgent::PromptBudget() const {
+    return std::max(256, config_.context_window - config_.max_tokens_per_step - 64);
+}
+
+int RecursiveAgent::ObservationBudget(int step_tokens) const {
+    // The header and summary are fixed costs. Recent steps keep a quarter
+    // of the budget (older ones get summarized anyway), and one result
+    // never takes more than half, so a huge LIST or GREP can't push every
+    // earlier step out of the transcript at once.
+    const int budget = PromptBudget();
+    const int fixed = transcript_header_tokens_ + summary_tokens_;
+    const int history = std::min(TranscriptTokens() - fixed, budget / 4);
+    const int MIN_OBSERVATION_TOKENS = 64;
+    return std::clamp(budget - fixed - history - step_tokens,
+                      MIN_OBSERVATION_TOKENS, budget / 2);
+}
+
+void RecursiveAgent::CompactTranscript() {
+    const int budget = PromptBudget();
+    const size_t max_steps = std::max(1, config_.history_window);
+    if (TranscriptTokens() <= budget && transcript_.size() <= max_steps) {
+        return;
+    }
+
+    // Summarizing changes the prompt after the header, which costs one
+    // re-prefill; fold well past the limits so that happens rarely
+    const int target_tokens = budget * 3 / 4;
+    const size_t target_steps = std::max<size_t>(1, max_steps / 2);
+    int tokens = TranscriptTokens();
+    size_t n_fold = 0;
+    while (n_fold + 1 < transcript_.size() &&
+           (tokens > target_tokens ||
+            transcript_.size() - n_fold > target_steps)) {
+        tokens -= transcript_[n_fold].tokens;
+        summary_lines_.push_back(transcript_[n_fold].summary_line);
+        ++n_fold;
+    }
+    if (n_fold == 0) {
+        return;
+    }
+    transcript_.erase(transcript_.begin(), transcript_.begin() + n_fold);
+
+    // Keep the summary itself bounded
+    const size_t MAX_SUMMARY_LINES = 32;
+    if (summary_lines_.size() > MAX_SUMMARY_LINES) {
+        summary_lines_.erase(summary_lines_.begin(),
+                             summary_lines_.end() - MAX_SUMMARY_LINES);
+    }
+    summary_text_ = "EARLIER STEPS (already done, do not repeat):\n";
+    for (const auto& line : summary_lines_) {
+        summary_text_ += line;
+    }
+    summary_text_ += "\n";
+    summary_tokens_ = model_.CountTokens(summary_text_);
 
-    return ss.str();
+    ReportProgress("Summarized " + std::to_string(n_fold) +
+                   " earlier steps to fit the context");
 }
 
 bool RecursiveAgent::ParseModelOutput(const std::string& output,
@@ -0,0 +1,82 @@
+#include "coder/tool_plan.hpp"
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+namespace zweek {
+namespace coder {
+
+bool ParseToolPlan(const std::string& json, std::vector<PlanStep>& steps) {
+    steps.clear();
+
+    nlohmann::json plan = nlohmann::json::parse(json, nullptr, false);
+    if (plan.is_discarded() || !plan.is_array()) {
+        return false;
+    }
+
+    for (const auto& entry : plan) {
+        if (!entry.is_object()) {
+            continue;
+        }
+        PlanStep step;
+        step.type = entry.value("type", "");
+        step.path = entry.value("path", "");
+        step.pattern = entry.value("pattern", "");
+        bool known = step.type == "read_file" || step.type == "search" ||
+                     step.type == "git_diff" || step.type == "write_file";
+        if (known && !step.path.empty()) {
+            steps.push_back(step);
+        }
+    }
+    return true;
+}
+
+std::string PlanStepCommand(const PlanStep& step) {
+    if (step.type == "read_file") {
+        return "READ_LINES " + step.path + " 1-" +
+               std::to_string(AgentToolSet::MAX_READ_LINES) + "\n";
+    }
+    if (step.type == "search" && !step.pattern.empty()) {
+        return "GREP " + step.pattern + " " + step.path + "\n";
+    }
+    if (step.type == "git_diff") {
+        return "GIT_DIFF " + step.path + "\n";
+    }
+    return "";
+}
+
+std::vector<ToolResult> RunToolPlan(AgentToolSet& toolset,
+                                    const std::vector<PlanStep>& steps,
+                                    size_t max_lookups,
+                                    std::vector<std::string>& commands,
+                                    std::vector<std::string>& edit_targets) {
+    commands.clear();
+    edit_targets.clear();
+    for (const auto& step : steps) {
+        if (step.type == "write_file") {
+            if (std::find(edit_targets.begin(), edit_targets.end(), step.path) ==
+                edit_targets.end()) {
+                edit_targets.push_back(step.path);
+            }
+            continue;
+        }
+        std::string command = PlanStepCommand(step);
+        if (!command.empty() && commands.size() < max_lookups &&
+            std::find(commands.begin(), commands.end(), command) == commands.end()) {
+            commands.push_back(command);
+        }
+    }
+
+    // Every command is read-only, so each batch runs fully in parallel
+    std::vector<ToolResult> results;
+    for (size_t i = 0; i < commands.size(); i += AgentToolSet::MAX_BATCH_COMMANDS) {
+        size_t end = std::min(commands.size(), i + AgentToolSet::MAX_BATCH_COMMANDS);
+        std::vector<std::string> batch(commands.begin() + i, commands.begin() + end);
+        for (auto& result : toolset.ExecuteBatch(batch)) {
+            results.push_back(std::move(result));
+        }
+    }
+    return results;
+}
+
+}  // namespace coder
+}  // namespace zweek
@@ -2,8 +2,11 @@
 #include "history/history_manager.hpp"
 #include "chat/chat_mode.hpp"
 #include "tools/tool_executor.hpp"
+#include "models/model_registry.hpp"
+#include "models/residency_manager.hpp"
 #include <algorithm>
 #include <filesystem>
+#include <sstream>
 
 namespace zweek {
 namespace commands {
@@ -237,6 +240,37 @@ CommandResult CommandHandler::HandleCommand(const std::string &input) {
     return result;
   }
 
+  // Handle /memory [budget <MiB>]
+  if (cmd == "memory") {
+    result.handled = true;
+    auto &residency = models::ResidencyManager::Instance();
+
+    std::istringstream arg_stream(args);
+    std::string sub;
+    long budget_mb = 0;
+    if (arg_stream >> sub) {
+      if (sub != "budget" || !(arg_stream >> budget_mb) || budget_mb <= 0) {
+        result.response = "Usage: /memory [budget <MiB>]";
+        return result;
+      }
+      residency.SetBudgetBytes((uint64_t)budget_mb * 1024 * 1024);
+      residency.MakeRoom(nullptr, 0);
+    }
+
+    result.response = models::ModelRegistry::Instance().FormatMemoryReport() +
+                       "\n" + residency.FormatStatus();
+    return result;
+  }
+
+  // Handle /routes
+  if (cmd == "routes") {
+    result.handled = true;
+    result.response = routing_stats_provider_
+                          ? routing_stats_provider_()
+                          : "Routing statistics unavailable.";
+    return result;
+  }
+
   return result;
 }
 
@@ -248,7 +282,9 @@ std::vector<std::string> CommandHandler::GetAvailableCommands() const {
     "load",
     "clear-history",
     "cd",
-    "ls"
+    "ls",
+    "memory",
+    "routes"
   };
 }
 
@@ -265,6 +301,8 @@ Available Commands:
   /clear-history - Clear current session history
   /cd <path> - Change working directory
   /ls [path] - List files in directory (current if no path given)
+  /memory [budget <MiB>] - Show model memory use, or set the RAM budget
+  /routes - Show how requests were routed (rules, cache, router model)
 
 Tips:
   • Type code requests: "add error handling" or "refactor this function"
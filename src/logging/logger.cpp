@@ -0,0 +1,275 @@
+#include "logging/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+namespace zweek {
+namespace logging {
+
+namespace {
+
+const char *LevelName(LogLevel level) {
+  switch (level) {
+  case LogLevel::Debug:
+    return "DEBUG";
+  case LogLevel::Info:
+    return "INFO";
+  case LogLevel::Warn:
+    return "WARN";
+  case LogLevel::Error:
+    return "ERROR";
+  }
+  return "INFO";
+}
+
+bool ParseLevel(const std::string &name, LogLevel &level) {
+  if (name == "debug") {
+    level = LogLevel::Debug;
+  } else if (name == "info") {
+    level = LogLevel::Info;
+  } else if (name == "warn") {
+    level = LogLevel::Warn;
+  } else if (name == "error") {
+    level = LogLevel::Error;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string RotatedPath(const std::string &dir, int index) {
+  std::filesystem::path path(dir);
+  if (index == 0) {
+    return (path / "zweek.log").string();
+  }
+  return (path / ("zweek." + std::to_string(index) + ".log")).string();
+}
+
+} // namespace
+
+Logger &Logger::Instance() {
+  static Logger instance;
+  return instance;
+}
+
+Logger::Logger() : ring_(std::make_unique<std::array<Slot, RING_SLOTS>>()) {
+  for (size_t i = 0; i < RING_SLOTS; ++i) {
+    (*ring_)[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+Logger::~Logger() { Stop(); }
+
+std::string Logger::GetDefaultLogDir() {
+#ifdef _WIN32
+  const char *home = getenv("USERPROFILE");
+  if (home) {
+    return std::string(home) + "\\.zweek\\logs";
+  }
+#else
+  const char *home = getenv("HOME");
+  if (home) {
+    return std::string(home) + "/.zweek/logs";
+  }
+#endif
+  return "";
+}
+
+bool Logger::Start(const std::string &dir, size_t max_bytes, int max_files) {
+  if (running_.load() || dir.empty()) {
+    return false;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  path_ = RotatedPath(dir, 0);
+  file_.open(path_, std::ios::app);
+  if (!file_) {
+    return false;
+  }
+  file_bytes_ = std::filesystem::file_size(path_, ec);
+  if (ec) {
+    file_bytes_ = 0;
+  }
+  max_bytes_ = max_bytes;
+  max_files_ = max_files;
+
+  const char *env = getenv("ZWEEK_LOG_LEVEL");
+  LogLevel level;
+  if (env && ParseLevel(env, level)) {
+    level_.store(level);
+  }
+
+  running_.store(true);
+  writer_ = std::thread(&Logger::WriterLoop, this);
+  return true;
+}
+
+void Logger::Stop() {
+  if (!running_.exchange(false)) {
+    return;
+  }
+  wake_.notify_one();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  file_.close();
+}
+
+void Logger::Log(LogLevel level, std::string_view component,
+                 std::string_view message) {
+  if (level < level_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // Claim a slot; never wait for the writer
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true) {
+    slot = &(*ring_)[pos & (RING_SLOTS - 1)];
+    size_t seq = slot->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return; // Full
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->level = level;
+  slot->time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+
+  // "component: message", truncated to the slot
+  size_t n = std::min(component.size(), MAX_MESSAGE_BYTES);
+  std::memcpy(slot->text, component.data(), n);
+  if (!component.empty() && n + 2 <= MAX_MESSAGE_BYTES) {
+    slot->text[n++] = ':';
+    slot->text[n++] = ' ';
+  }
+  size_t m = std::min(message.size(), MAX_MESSAGE_BYTES - n);
+  std::memcpy(slot->text + n, message.data(), m);
+  n += m;
+  // Strip trailing newlines (llama.cpp ends its lines with one)
+  while (n > 0 && (slot->text[n - 1] == '\n' || slot->text[n - 1] == '\r')) {
+    --n;
+  }
+  slot->length = n;
+
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::Pop(Slot &out) {
+  Slot &slot = (*ring_)[dequeue_pos_ & (RING_SLOTS - 1)];
+  size_t seq = slot.sequence.load(std::memory_order_acquire);
+  if (seq != dequeue_pos_ + 1) {
+    return false; // Empty, or the producer is still writing
+  }
+
+  out.level = slot.level;
+  out.time_ms = slot.time_ms;
+  out.length = slot.length;
+  std::memcpy(out.text, slot.text, slot.length);
+
+  slot.sequence.store(dequeue_pos_ + RING_SLOTS, std::memory_order_release);
+  ++dequeue_pos_;
+  return true;
+}
+
+void Logger::WriterLoop() {
+  Slot slot;
+  while (true) {
+    bool wrote = false;
+    while (Pop(slot)) {
+      WriteLine(slot);
+      wrote = true;
+    }
+
+    uint64_t drops = dropped_.load();
+    if (drops != reported_drops_) {
+      Slot note;
+      note.level = LogLevel::Warn;
+      note.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+      std::string text = "logger: dropped " +
+                         std::to_string(drops - reported_drops_) + " messages";
+      note.length = std::min(text.size(), MAX_MESSAGE_BYTES);
+      std::memcpy(note.text, text.data(), note.length);
+      WriteLine(note);
+      reported_drops_ = drops;
+      wrote = true;
+    }
+
+    if (wrote) {
+      file_.flush();
+    }
+    if (!running_.load()) {
+      // Producers may have raced with Stop(); take what is left
+      while (Pop(slot)) {
+        WriteLine(slot);
+      }
+      file_.flush();
+      return;
+    }
+
+    // Producers don't notify (that could block them); poll instead
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    wake_.wait_for(lock, std::chrono::milliseconds(50));
+  }
+}
+
+void Logger::WriteLine(const Slot &slot) {
+  std::time_t seconds = slot.time_ms / 1000;
+  std::tm tm_buf;
+#ifdef _WIN32
+  localtime_s(&tm_buf, &seconds);
+#else
+  localtime_r(&seconds, &tm_buf);
+#endif
+  char stamp[32];
+  size_t n = std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_buf);
+  std::snprintf(stamp + n, sizeof(stamp) - n, ".%03d",
+                (int)(slot.time_ms % 1000));
+
+  std::string line = std::string(stamp) + " " + LevelName(slot.level) + " " +
+                     std::string(slot.text, slot.length) + "\n";
+  file_ << line;
+  file_bytes_ += line.size();
+  RotateIfNeeded();
+}
+
+void Logger::RotateIfNeeded() {
+  if (max_bytes_ == 0 || file_bytes_ < max_bytes_) {
+    return;
+  }
+
+  std::string dir = std::filesystem::path(path_).parent_path().string();
+  file_.close();
+
+  std::error_code ec;
+  std::filesystem::remove(RotatedPath(dir, max_files_), ec);
+  for (int i = max_files_ - 1; i >= 0; --i) {
+    std::filesystem::rename(RotatedPath(dir, i), RotatedPath(dir, i + 1), ec);
+  }
+  if (max_files_ <= 0) {
+    std::filesystem::remove(path_, ec);
+  }
+
+  file_.open(path_, std::ios::trunc);
+  file_bytes_ = 0;
+}
+
+} // namespace logging
+} // namespace zweek
@@ -1,7 +1,14 @@
+#include "logging/logger.hpp"
+#include "pipeline/inference_service.hpp"
+#include "models/residency_manager.hpp"
 #include "pipeline/orchestrator.hpp"
 #include "ui/tui.hpp"
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <thread>
 
 using namespace zweek::ui;
@@ -14,6 +21,11 @@ int main(int argc, char **argv) {
     working_dir = argv[1];
   }
 
+  // Diagnostics go to ~/.zweek/logs; stdout and stderr belong to the TUI.
+  // The logger drains and stops in its destructor, after the models are gone.
+  zweek::logging::Logger::Instance().Start();
+  zweek::logging::LogInfo("main", "Starting in " + working_dir);
+
   TUI tui;
   Orchestrator orchestrator;
   
@@ -44,11 +56,53 @@ int main(int argc, char **argv) {
     tui.AddToHistory("Session initialized: " + history_mgr->GetCurrentSessionId());
   }
 
+  // Streamed output reaches the TUI through each request's token channel,
+  // drained in submission order by the stream thread below. Other updates
+  // from a request wait for the stream to catch up so they stay in order.
+  std::atomic<bool> running{true};
+  std::mutex stream_mutex;
+  std::condition_variable stream_cv;
+  std::deque<std::shared_ptr<TokenChannel>> streams;
+  uint64_t chunks_pushed = 0;
+  uint64_t chunks_shown = 0;
+  auto wait_for_stream = [&]() {
+    std::unique_lock<std::mutex> lock(stream_mutex);
+    stream_cv.wait(lock,
+                   [&]() { return chunks_shown == chunks_pushed || !running; });
+  };
+
+  std::thread stream_thread([&]() {
+    while (true) {
+      std::shared_ptr<TokenChannel> channel;
+      {
+        std::unique_lock<std::mutex> lock(stream_mutex);
+        stream_cv.wait(lock, [&]() { return !streams.empty() || !running; });
+        if (streams.empty()) {
+          return;
+        }
+        channel = streams.front();
+        streams.pop_front();
+      }
+      std::string chunk;
+      while (channel->Pop(chunk)) {
+        tui.AppendToLastMessage(chunk);
+        {
+          std::lock_guard<std::mutex> lock(stream_mutex);
+          ++chunks_shown;
+        }
+        stream_cv.notify_all();
+      }
+    }
+  });
+
   // Connect orchestrator callbacks to TUI
-  orchestrator.SetProgressCallback(
-      [&](const std::string &status) { tui.AddToHistory(status); });
+  orchestrator.SetProgressCallback([&](const std::string &status) {
+    wait_for_stream();
+    tui.AddToHistory(status);
+  });
 
   orchestrator.SetResponseCallback([&](const std::string &response) {
+    wait_for_stream();
     // Only add to history if response is not empty
     if (!response.empty()) {
       tui.AddToHistory(response);
@@ -56,26 +110,82 @@ int main(int argc, char **argv) {
     tui.UpdateStage(PipelineStage::Complete, 1.0f);
   });
 
-  orchestrator.SetStreamCallback([&](const std::string &chunk) {
-    tui.AppendToLastMessage(chunk);
+  orchestrator.SetPrefillProgressCallback([&](int done, int total) {
+    tui.SetPrefillProgress(done, total);
   });
+
+  orchestrator.SetInferenceStatsCallback(
+      [&](const zweek::models::InferenceStats &stats) {
+        tui.SetInferenceSpeed(stats.DecodeTokensPerSec(),
+                              stats.PrefillTokensPerSec(), stats.ttft_ms);
+      });
   
-  // Connect interrupt flag from TUI to orchestrator
-  orchestrator.SetInterruptFlag(&tui.GetState().interrupt_inference_);
+  // All model work runs on the service's worker, one request at a time.
+  // Declared after the orchestrator so it stops before the models go away.
+  InferenceService inference_service;
+  std::mutex requests_mutex;
+  std::vector<InferenceHandle> active_requests;
+
+  // ESC cancels the running request and anything queued behind it
+  tui.SetOnInterrupt([&]() {
+    std::lock_guard<std::mutex> lock(requests_mutex);
+    for (auto &handle : active_requests) {
+      handle.Cancel();
+    }
+    active_requests.clear();
+  });
 
   // Set up TUI callbacks
   tui.SetOnSubmit([&](const std::string &request) {
     std::cout << "Processing: " << request << std::endl;
-    
-    // Reset interrupt flag before starting new request
-    tui.GetState().interrupt_inference_.store(false);
-
-    // Run orchestrator in background thread
-    std::thread pipeline_thread([&, request]() {
-      tui.UpdateStage(PipelineStage::Planning, 0.1f);
-      orchestrator.ProcessRequest(request);
-    });
-    pipeline_thread.detach();
+
+    // Queue behind any request still running
+    InferenceHandle handle = inference_service.Submit(
+        [&, request](JobContext &job) {
+          tui.GetState().interrupt_inference_.store(false);
+          orchestrator.SetInterruptFlag(job.cancel);
+          orchestrator.SetStreamCallback([&, tokens = job.tokens](
+                                             const std::string &chunk) {
+            {
+              std::lock_guard<std::mutex> lock(stream_mutex);
+              ++chunks_pushed;
+            }
+            tokens->Push(chunk);
+          });
+          tui.UpdateStage(PipelineStage::Planning, 0.1f);
+          orchestrator.ProcessRequest(request);
+
+          // Both point into this job, which is about to end
+          orchestrator.SetInterruptFlag(nullptr);
+          orchestrator.SetStreamCallback(nullptr);
+          tui.SetPrefillProgress(0, 0);
+          return std::string();
+        },
+        Priority::Foreground);
+
+    // Rejected outright (queue full)
+    auto result = handle.Result();
+    if (result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      tui.AddToHistory(result.get());
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      streams.push_back(handle.Tokens());
+    }
+    stream_cv.notify_all();
+
+    std::lock_guard<std::mutex> lock(requests_mutex);
+    // Forget requests that have finished
+    active_requests.erase(
+        std::remove_if(active_requests.begin(), active_requests.end(),
+                       [](const InferenceHandle &h) {
+                         return h.Result().wait_for(std::chrono::seconds(0)) ==
+                                std::future_status::ready;
+                       }),
+        active_requests.end());
+    active_requests.push_back(handle);
   });
 
   tui.SetOnAccept([]() { std::cout << "Changes accepted!" << std::endl; });
@@ -86,7 +196,6 @@ int main(int argc, char **argv) {
       []() { std::cout << "Requesting modifications..." << std::endl; });
   
   // Spinner animation thread - update every 100ms
-  std::atomic<bool> running{true};
   std::thread spinner_thread([&]() {
     while (running) {
       tui.GetState().spinner_frame++;
@@ -95,10 +204,40 @@ int main(int argc, char **argv) {
   });
   spinner_thread.detach();
 
+  // Respond to system memory pressure while idle. The check runs as a
+  // background job so it never races the models' own thread.
+  std::thread memory_thread([&]() {
+    int ticks = 0;
+    while (running) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if (++ticks % 50 != 0) {
+        continue;
+      }
+      if (!inference_service.IsBusy() && inference_service.QueuedCount() == 0) {
+        inference_service.Submit(
+            [](JobContext &) {
+              zweek::models::ResidencyManager::Instance().CheckPressure();
+              return std::string();
+            },
+            Priority::Background);
+      }
+    }
+  });
+
   // Run the TUI
   tui.Run();
   
-  running = false; // Stop spinner thread
+  running = false; // Stop spinner and memory threads
+  memory_thread.join();
+
+  // Cancel outstanding requests and wait for the worker to stop. That
+  // closes every channel, so the stream thread drains them and exits.
+  inference_service.Shutdown();
+  {
+    std::lock_guard<std::mutex> lock(stream_mutex);
+  }
+  stream_cv.notify_all();
+  stream_thread.join();
 
   // Save history on exit
   if (history_mgr) {
@@ -0,0 +1,87 @@
+#include "models/grammar_cache.hpp"
+#include <cstring>
+#include <llama.h>
+
+namespace zweek {
+namespace models {
+
+GrammarCache &GrammarCache::Instance() {
+  static GrammarCache instance;
+  return instance;
+}
+
+GrammarCache::~GrammarCache() {
+  for (auto &[key, proto] : prototypes_) {
+    llama_sampler_free(proto);
+  }
+}
+
+llama_sampler *GrammarCache::CreateChain(const llama_vocab *vocab,
+                                         const std::string &grammar) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto key = std::make_pair(vocab, grammar);
+  auto it = prototypes_.find(key);
+  if (it == prototypes_.end()) {
+    auto sparams = llama_sampler_chain_default_params();
+    llama_sampler *proto = llama_sampler_chain_init(sparams);
+    if (!proto) {
+      return nullptr;
+    }
+
+    if (!grammar.empty()) {
+      // Try to create grammar sampler
+      llama_sampler *gs =
+          llama_sampler_init_grammar(vocab, grammar.c_str(), "root");
+      if (gs) {
+        llama_sampler_chain_add(proto, gs);
+      }
+    }
+
+    // Add standard samplers
+    llama_sampler_chain_add(proto, llama_sampler_init_top_k(40));
+    llama_sampler_chain_add(proto, llama_sampler_init_top_p(0.95f, 1));
+    llama_sampler_chain_add(proto, llama_sampler_init_temp(0.7f));
+
+    it = prototypes_.emplace(key, proto).first;
+  }
+
+  llama_sampler *chain = llama_sampler_clone(it->second);
+  if (!chain) {
+    return nullptr;
+  }
+
+  // The dist sampler is added per clone so each chain gets its own seed
+  // instead of copying the prototype's RNG state
+  llama_sampler_chain_add(chain, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+  return chain;
+}
+
+llama_sampler *GrammarCache::GrammarStage(llama_sampler *chain) {
+  if (!chain || llama_sampler_chain_n(chain) == 0) {
+    return nullptr;
+  }
+  llama_sampler *first = llama_sampler_chain_get(chain, 0);
+  return std::strcmp(llama_sampler_name(first), "grammar") == 0 ? first
+                                                                 : nullptr;
+}
+
+void GrammarCache::Evict(const llama_vocab *vocab) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = prototypes_.begin(); it != prototypes_.end();) {
+    if (it->first.first == vocab) {
+      llama_sampler_free(it->second);
+      it = prototypes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t GrammarCache::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return prototypes_.size();
+}
+
+} // namespace models
+} // namespace zweek
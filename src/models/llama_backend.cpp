@@ -0,0 +1,42 @@
+#include "models/llama_backend.hpp"
+#include "logging/logger.hpp"
+#include <llama.h>
+
+namespace zweek {
+namespace models {
+
+namespace {
+
+void LogCallback(ggml_log_level level, const char *text, void *) {
+  logging::LogLevel mapped;
+  switch (level) {
+  case GGML_LOG_LEVEL_ERROR:
+    mapped = logging::LogLevel::Error;
+    break;
+  case GGML_LOG_LEVEL_WARN:
+    mapped = logging::LogLevel::Warn;
+    break;
+  case GGML_LOG_LEVEL_INFO:
+    mapped = logging::LogLevel::Info;
+    break;
+  default:
+    // Debug output and line continuations (e.g. load progress dots)
+    mapped = logging::LogLevel::Debug;
+    break;
+  }
+  logging::Logger::Instance().Log(mapped, "llama", text);
+}
+
+} // namespace
+
+void LlamaBackend::EnsureInitialized() { static LlamaBackend instance; }
+
+LlamaBackend::LlamaBackend() {
+  llama_log_set(LogCallback, nullptr);
+  llama_backend_init();
+}
+
+LlamaBackend::~LlamaBackend() { llama_backend_free(); }
+
+} // namespace models
+} // namespace zweek
@@ -1,31 +1,213 @@
 #include "models/model_loader.hpp"
+#include "logging/logger.hpp"
+#include "models/grammar_cache.hpp"
+#include "models/llama_backend.hpp"
+#include "models/model_registry.hpp"
+#include "models/residency_manager.hpp"
+#include "models/stop_sequence_matcher.hpp"
+#include "models/stream_sink.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <iostream>
+#include <filesystem>
+#include <fstream>
 #include <llama.h>
 
 namespace zweek {
 namespace models {
 
-ModelLoader::ModelLoader() {
-// Suppress llama.cpp logs completely (redirect stderr)
-#ifdef _WIN32
-  freopen("NUL", "w", stderr); // Windows
-#else
-  freopen("/dev/null", "w", stderr); // Unix
-#endif
+namespace {
+
+// Tokenize with the flags every prompt uses, so shared prefixes line up.
+// add_bos is false only for text that continues an already tokenized prompt.
+std::vector<llama_token> TokenizeText(const llama_vocab *vocab,
+                                      const std::string &text,
+                                      bool add_bos = true) {
+  std::vector<llama_token> tokens(text.size() + 16);
+  int n = llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(),
+                         tokens.size(), add_bos, true);
+  if (n < 0) {
+    // Buffer too small: -n is the required size
+    tokens.resize(-n);
+    n = llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(),
+                       tokens.size(), add_bos, true);
+    if (n < 0) {
+      return {};
+    }
+  }
+  tokens.resize(n);
+  return tokens;
+}
+
+// 64-bit FNV-1a
+uint64_t Fnv1a(const void *data, size_t len,
+               uint64_t hash = 14695981039346656037ULL) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string ToHex(uint64_t value) {
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx",
+                static_cast<unsigned long long>(value));
+  return buf;
+}
+
+// Hashing the whole weights file would cost more than the prefill it saves,
+// so hash the size plus the head (GGUF header, metadata, vocab) and the tail.
+std::string FingerprintModelFile(const std::string &path) {
+  constexpr size_t HEAD_BYTES = 4 << 20;
+  constexpr size_t TAIL_BYTES = 1 << 20;
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return "";
+  }
+
+  uint64_t size = static_cast<uint64_t>(file.tellg());
+  uint64_t hash = Fnv1a(&size, sizeof(size));
+
+  std::vector<char> buf(std::min<uint64_t>(HEAD_BYTES, size));
+  file.seekg(0);
+  file.read(buf.data(), buf.size());
+  hash = Fnv1a(buf.data(), file.gcount(), hash);
+
+  if (size > HEAD_BYTES) {
+    uint64_t tail = std::min<uint64_t>(TAIL_BYTES, size - HEAD_BYTES);
+    buf.resize(tail);
+    file.clear();
+    file.seekg(size - tail);
+    file.read(buf.data(), buf.size());
+    hash = Fnv1a(buf.data(), file.gcount(), hash);
+  }
+
+  return ToHex(hash);
+}
 
-  llama_backend_init();
-  llama_log_set(nullptr, nullptr);
+// Same vocabulary: draft tokens can be verified without re-tokenizing
+bool VocabsCompatible(const llama_vocab *a, const llama_vocab *b) {
+  int n = llama_vocab_n_tokens(a);
+  if (n != llama_vocab_n_tokens(b) ||
+      llama_vocab_bos(a) != llama_vocab_bos(b) ||
+      llama_vocab_eos(a) != llama_vocab_eos(b)) {
+    return false;
+  }
+  // Spot-check token texts across the vocab
+  int step = std::max(1, n / 512);
+  for (int i = 0; i < n; i += step) {
+    if (std::strcmp(llama_vocab_get_text(a, i), llama_vocab_get_text(b, i)) != 0) {
+      return false;
+    }
+  }
+  return true;
 }
 
+// ggml type for a KV cache type name
+bool ParseKvType(const std::string &name, ggml_type &type) {
+  static const std::pair<const char *, ggml_type> TYPES[] = {
+      {"f32", GGML_TYPE_F32},   {"f16", GGML_TYPE_F16},
+      {"bf16", GGML_TYPE_BF16}, {"q8_0", GGML_TYPE_Q8_0},
+      {"q5_1", GGML_TYPE_Q5_1}, {"q5_0", GGML_TYPE_Q5_0},
+      {"q4_1", GGML_TYPE_Q4_1}, {"q4_0", GGML_TYPE_Q4_0}};
+  for (const auto &[type_name, value] : TYPES) {
+    if (name == type_name) {
+      type = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsQuantized(ggml_type type) {
+  return type != GGML_TYPE_F32 && type != GGML_TYPE_F16 &&
+         type != GGML_TYPE_BF16;
+}
+
+// Sequences decoded together by InferBatch
+constexpr int MAX_BATCH_SEQUENCES = 4;
+
+// Longest grammar-forced text appended in one jump-forward step
+constexpr size_t MAX_FORCED_CHARS = 32;
+
+// Total size of saved prefix states. Every context size, KV type or
+// prompt edit keys a new file, so old ones are evicted least recently
+// used first (restoring a state refreshes its time).
+constexpr uint64_t MAX_STATE_CACHE_BYTES = 256ull * 1024 * 1024;
+
+// Temporaries older than this were left by a crashed write
+constexpr auto STALE_TMP_AGE = std::chrono::hours(1);
+
+void PruneStateCache(const std::string &dir, const std::string &keep) {
+  namespace fs = std::filesystem;
+  std::error_code ec;
+
+  struct Entry {
+    fs::path path;
+    fs::file_time_type time;
+    uint64_t size;
+  };
+  std::vector<Entry> states;
+  uint64_t total = 0;
+  const auto now = fs::file_time_type::clock::now();
+
+  for (const auto &file : fs::directory_iterator(dir, ec)) {
+    std::error_code file_ec;
+    if (!file.is_regular_file(file_ec)) {
+      continue;
+    }
+    auto time = file.last_write_time(file_ec);
+    if (file_ec) {
+      continue;
+    }
+    std::string name = file.path().filename().string();
+    if (name.find(".state.tmp") != std::string::npos) {
+      if (now - time > STALE_TMP_AGE) {
+        fs::remove(file.path(), file_ec);
+      }
+    } else if (file.path().extension() == ".state") {
+      uint64_t size = file.file_size(file_ec);
+      if (!file_ec) {
+        states.push_back({file.path(), time, size});
+        total += size;
+      }
+    }
+  }
+
+  std::sort(states.begin(), states.end(),
+            [](const Entry &a, const Entry &b) { return a.time < b.time; });
+  for (const auto &state : states) {
+    if (total <= MAX_STATE_CACHE_BYTES) {
+      break;
+    }
+    if (state.path == fs::path(keep)) {
+      continue;
+    }
+    std::error_code remove_ec;
+    if (fs::remove(state.path, remove_ec)) {
+      total -= state.size;
+      logging::LogInfo("model", "Evicted prefix state " +
+                                    state.path.filename().string());
+    }
+  }
+}
+
+} // namespace
+
+ModelLoader::ModelLoader() { LlamaBackend::EnsureInitialized(); }
+
 ModelLoader::~ModelLoader() {
   // Force unload even for resident models on destruction
   bool was_resident = is_resident_;
   is_resident_ = false;
   Unload();
   is_resident_ = was_resident;
-
-  llama_backend_free();
 }
 
 bool ModelLoader::LoadResident(const std::string &model_path, int n_ctx) {
@@ -42,151 +224,880 @@ bool ModelLoader::Load(const std::string &model_path, int n_ctx) {
   }
   is_resident_ = was_resident;
 
+  evicted_ = false;
   n_ctx_ = n_ctx;
+  requested_n_ctx_ = n_ctx;
+  model_path_ = model_path;
+  model_fingerprint_.clear();
 
-  // Load model
-  llama_model_params model_params = llama_model_default_params();
-  model_ = llama_model_load_from_file(model_path.c_str(), model_params);
+  // Make room within the memory budget for weights not yet in memory
+  auto &residency = ResidencyManager::Instance();
+  if (residency_managed_ && !ModelRegistry::Instance().IsLoaded(model_path)) {
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(model_path, ec);
+    residency.MakeRoom(this, ec ? 0 : file_size);
+  }
+
+  // Load model (shared with any other loader using the same file)
+  model_handle_ = ModelRegistry::Instance().Acquire(model_path);
+  model_ = model_handle_.get();
 
   if (!model_) {
-    std::cerr << "Failed to load model: " << model_path << std::endl;
     return false;
   }
+  pieces_ = PieceTable::For(llama_model_get_vocab(model_));
+
+  ResolveThreads();
 
   // Create context
+  if (!CreateContext()) {
+    logging::LogError("model", "Failed to create context for " + model_path);
+    model_handle_.reset();
+    model_ = nullptr;
+    pieces_.reset();
+    return false;
+  }
+
+  // Create sampler
+  sampler_ = CreateSamplerChain("");
+
+  // First load of this model on this machine: find the fastest counts
+  bool automatic = thread_config_.n_threads_decode <= 0 ||
+                   thread_config_.n_threads_prefill <= 0;
+  int cached_decode, cached_prefill;
+  if (automatic && thread_config_.calibrate &&
+      !LoadCalibratedThreads(Fingerprint(), cached_decode, cached_prefill)) {
+    CalibrateThreads();
+  }
+
+  if (residency_managed_) {
+    residency.Register(this);
+    // The KV cache is known now; evict others if it pushed us over budget
+    residency.MakeRoom(this, 0);
+  }
+
+  // Model loaded successfully (silent - don't spam TUI)
+  return true;
+}
+
+bool ModelLoader::CreateContext() {
+  if (ctx_) {
+    ModelRegistry::Instance().UnregisterContext(ctx_);
+    llama_free(ctx_);
+    ctx_ = nullptr;
+  }
+  cached_tokens_.clear();
+
   llama_context_params ctx_params = llama_context_default_params();
-  ctx_params.n_ctx = n_ctx;
-  ctx_params.n_batch = 512;
-  ctx_params.n_threads = 4; // Use 4 threads for old hardware
+  ctx_params.n_ctx = n_ctx_;
+  ctx_params.n_batch = n_batch_;
+  ctx_params.n_threads = n_threads_decode_;
+  ctx_params.n_threads_batch = n_threads_prefill_;
+  // Sequence 0 holds the prefix cache, 1..N are InferBatch slots. A unified
+  // KV cache lets any sequence use the whole context.
+  ctx_params.n_seq_max = MAX_BATCH_SEQUENCES + 1;
+  ctx_params.kv_unified = true;
+
+  // Names were validated by SetKvCacheConfig
+  ParseKvType(kv_config_.type_k, ctx_params.type_k);
+  ParseKvType(kv_config_.type_v, ctx_params.type_v);
+  if (kv_config_.flash_attn || IsQuantized(ctx_params.type_v)) {
+    ctx_params.flash_attn_type = LLAMA_FLASH_ATTN_TYPE_ENABLED;
+  }
 
   ctx_ = llama_new_context_with_model(model_, ctx_params);
+  if (!ctx_) {
+    return false;
+  }
 
+  llama_set_abort_callback(ctx_, &ModelLoader::ShouldAbort, this);
+  ApplyThreads();
+
+  ModelRegistry::Instance().RegisterContext(
+      ctx_, model_, name_, n_ctx_,
+      ModelRegistry::EstimateKvCacheBytes(model_, n_ctx_, ctx_params.type_k,
+                                          ctx_params.type_v),
+      kv_config_.type_k + "/" + kv_config_.type_v);
+  return true;
+}
+
+const std::string &ModelLoader::Fingerprint() {
+  if (model_fingerprint_.empty()) {
+    model_fingerprint_ = FingerprintModelFile(model_path_);
+  }
+  return model_fingerprint_;
+}
+
+bool ModelLoader::SetKvCacheConfig(const KvCacheConfig &config) {
+  ggml_type type;
+  if (!ParseKvType(config.type_k, type) || !ParseKvType(config.type_v, type)) {
+    return false;
+  }
+  kv_config_ = config;
+  if (model_) {
+    return CreateContext();
+  }
+  return true;
+}
+
+void ModelLoader::SetThreadConfig(const ThreadConfig &config) {
+  thread_config_ = config;
+  if (model_) {
+    ResolveThreads();
+    ApplyThreads();
+  }
+}
+
+void ModelLoader::ResolveThreads() {
+  int physical = GetPhysicalCpus().size();
+  int decode = physical, prefill = physical;
+
+  int cached_decode, cached_prefill;
+  if (LoadCalibratedThreads(Fingerprint(), cached_decode, cached_prefill)) {
+    decode = cached_decode;
+    prefill = cached_prefill;
+  }
+
+  n_threads_decode_ = thread_config_.n_threads_decode > 0
+                          ? thread_config_.n_threads_decode
+                          : decode;
+  n_threads_prefill_ = thread_config_.n_threads_prefill > 0
+                           ? thread_config_.n_threads_prefill
+                           : prefill;
+}
+
+void ModelLoader::ApplyThreads() {
   if (!ctx_) {
-    std::cerr << "Failed to create context" << std::endl;
-    llama_free_model(model_);
-    model_ = nullptr;
+    return;
+  }
+  llama_set_n_threads(ctx_, n_threads_decode_, n_threads_prefill_);
+
+  // Reuse the process-wide pools instead of spawning threads per context
+  auto &pools = ThreadPools::Instance();
+  ggml_threadpool *decode_pool =
+      pools.Get(n_threads_decode_, thread_config_.pin_threads);
+  ggml_threadpool *prefill_pool =
+      pools.Get(n_threads_prefill_, thread_config_.pin_threads);
+  if (decode_pool && prefill_pool) {
+    llama_attach_threadpool(ctx_, decode_pool, prefill_pool);
+  }
+}
+
+bool ModelLoader::CalibrateThreads() {
+  if (!model_ || !ctx_) {
     return false;
   }
 
-  // Create sampler
-  auto sparams = llama_sampler_chain_default_params();
-  sampler_ = llama_sampler_chain_init(sparams);
+  // Candidate counts: powers of two up to the physical core count
+  int physical = GetPhysicalCpus().size();
+  std::vector<int> candidates;
+  for (int n = 2; n < physical; n *= 2) {
+    candidates.push_back(n);
+  }
+  candidates.push_back(physical);
+
+  // A fixed prompt of up to 128 tokens
+  const llama_vocab *vocab = llama_model_get_vocab(model_);
+  std::string text;
+  for (int i = 0; i < 32; ++i) {
+    text += "The quick brown fox jumps over the lazy dog. ";
+  }
+  std::vector<llama_token> tokens = TokenizeText(vocab, text);
+  int n_prompt = std::min<int>({(int)tokens.size(), 128, n_batch_, n_ctx_ / 2});
+  const int n_decode = 16;
+  if (n_prompt < n_decode) {
+    return false;
+  }
 
-  llama_sampler_chain_add(sampler_, llama_sampler_init_top_k(40));
-  llama_sampler_chain_add(sampler_, llama_sampler_init_top_p(0.95f, 1));
-  llama_sampler_chain_add(sampler_, llama_sampler_init_temp(0.7f));
-  llama_sampler_chain_add(sampler_,
-                          llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+  using Clock = std::chrono::steady_clock;
+  llama_memory_t mem = llama_get_memory(ctx_);
+  llama_detach_threadpool(ctx_);
+  ClearCache();
+
+  int best_decode = n_threads_decode_, best_prefill = n_threads_prefill_;
+  double best_decode_tps = 0.0, best_prefill_tps = 0.0;
+  bool warmed_up = false;
+
+  for (int n : candidates) {
+    llama_set_n_threads(ctx_, n, n);
+
+    // The first decode allocates compute buffers; keep it out of the timing
+    if (!warmed_up) {
+      llama_decode(ctx_, llama_batch_get_one(tokens.data(), n_prompt));
+      llama_memory_clear(mem, true);
+      warmed_up = true;
+    }
+
+    auto start = Clock::now();
+    if (llama_decode(ctx_, llama_batch_get_one(tokens.data(), n_prompt)) !=
+        0) {
+      break;
+    }
+    double prefill_s =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    bool ok = true;
+    for (int i = 0; i < n_decode && ok; ++i) {
+      ok = llama_decode(ctx_, llama_batch_get_one(&tokens[i], 1)) == 0;
+    }
+    double decode_s =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    llama_memory_clear(mem, true);
+    if (!ok) {
+      break;
+    }
+
+    double prefill_tps = n_prompt / std::max(prefill_s, 1e-9);
+    double decode_tps = n_decode / std::max(decode_s, 1e-9);
+    if (prefill_tps > best_prefill_tps) {
+      best_prefill_tps = prefill_tps;
+      best_prefill = n;
+    }
+    if (decode_tps > best_decode_tps) {
+      best_decode_tps = decode_tps;
+      best_decode = n;
+    }
+  }
+
+  bool measured = best_decode_tps > 0.0 && best_prefill_tps > 0.0;
+  if (measured) {
+    SaveCalibratedThreads(Fingerprint(), best_decode, best_prefill);
+    if (thread_config_.n_threads_decode <= 0) {
+      n_threads_decode_ = best_decode;
+    }
+    if (thread_config_.n_threads_prefill <= 0) {
+      n_threads_prefill_ = best_prefill;
+    }
+  }
+  ApplyThreads();
+  return measured;
+}
+
+bool ModelLoader::ShouldAbort(void *data) {
+  auto *self = static_cast<ModelLoader *>(data);
+  return self->active_interrupt_ && self->active_interrupt_->load();
+}
+
+bool ModelLoader::DecodePrompt(const std::vector<llama_token> &tokens,
+                               std::atomic<bool> *interrupt_flag) {
+  // Find how much of the prompt is already in the KV cache. The last prompt
+  // token is always decoded again so there are fresh logits to sample from.
+  size_t n_past = 0;
+  while (n_past < cached_tokens_.size() && n_past < tokens.size() &&
+         cached_tokens_[n_past] == tokens[n_past]) {
+    ++n_past;
+  }
+  if (n_past == tokens.size()) {
+    --n_past;
+  }
+
+  // Drop the diverging tail; fall back to a full clear if the memory
+  // cannot remove a partial sequence
+  llama_memory_t mem = llama_get_memory(ctx_);
+  if (n_past < cached_tokens_.size()) {
+    if (!llama_memory_seq_rm(mem, 0, n_past, -1)) {
+      llama_memory_clear(mem, true);
+      n_past = 0;
+    }
+    cached_tokens_.resize(n_past);
+  }
+
+  // Decode the rest in chunks no larger than n_batch
+  const int chunk = std::max(1, std::min(prefill_chunk_size_, n_batch_));
+  const int total = tokens.size() - n_past;
+  int done = 0;
+  last_stats_.prefill_tokens = total;
+
+  if (prefill_progress_callback_ && total > chunk) {
+    prefill_progress_callback_(0, total);
+  }
+
+  active_interrupt_ = interrupt_flag;
+  while (done < total) {
+    if (interrupt_flag && interrupt_flag->load()) {
+      break;
+    }
+
+    int n = std::min(chunk, total - done);
+    std::vector<llama_token> part(tokens.begin() + n_past + done,
+                                  tokens.begin() + n_past + done + n);
+    llama_batch batch = llama_batch_get_one(part.data(), n);
+    if (llama_decode(ctx_, batch) != 0) {
+      break;
+    }
+
+    // Track completed chunks so an interrupted prefill resumes from here
+    cached_tokens_.insert(cached_tokens_.end(), part.begin(), part.end());
+    done += n;
+
+    if (prefill_progress_callback_) {
+      prefill_progress_callback_(done, total);
+    }
+  }
+  active_interrupt_ = nullptr;
+
+  if (done < total) {
+    // Drop anything a failed or aborted chunk may have left behind
+    if (!llama_memory_seq_rm(mem, 0, cached_tokens_.size(), -1)) {
+      ClearCache();
+    }
+    if (prefill_progress_callback_) {
+      prefill_progress_callback_(0, 0); // No prefill in progress any more
+    }
+    return false;
+  }
 
-  // Model loaded successfully (silent - don't spam TUI)
   return true;
 }
 
+std::string ModelLoader::GetDefaultStateCacheDir() {
+#ifdef _WIN32
+  const char *home = getenv("USERPROFILE");
+  if (home) {
+    return std::string(home) + "\\.zweek\\cache";
+  }
+#else
+  const char *home = getenv("HOME");
+  if (home) {
+    return std::string(home) + "/.zweek/cache";
+  }
+#endif
+  return ""; // No home directory: disk cache disabled
+}
+
+std::string ModelLoader::StateCachePath(const std::vector<llama_token> &tokens) {
+  if (state_cache_dir_.empty()) {
+    return "";
+  }
+
+  if (Fingerprint().empty()) {
+    return "";
+  }
+
+  // Anything that changes the saved KV layout must be part of the key
+  std::string params = "n_ctx=" + std::to_string(n_ctx_) +
+                       ";n_batch=" + std::to_string(n_batch_) +
+                       ";type_k=" + kv_config_.type_k +
+                       ";type_v=" + kv_config_.type_v +
+                       ";flash_attn=" + std::to_string(kv_config_.flash_attn);
+  uint64_t key = Fnv1a(model_fingerprint_.data(), model_fingerprint_.size());
+  key = Fnv1a(tokens.data(), tokens.size() * sizeof(llama_token), key);
+  key = Fnv1a(params.data(), params.size(), key);
+
+  std::string stem = std::filesystem::path(model_path_).stem().string();
+  return (std::filesystem::path(state_cache_dir_) /
+          (stem + "-" + ToHex(key) + ".state"))
+      .string();
+}
+
+bool ModelLoader::WarmPrefix(const std::string &prefix) {
+  EnsureReady();
+  if (!model_ || !ctx_ || !prefix_caching_) {
+    return false;
+  }
+
+  std::vector<llama_token> tokens =
+      TokenizeText(llama_model_get_vocab(model_), prefix);
+  if (tokens.empty()) {
+    return false;
+  }
+
+  // Context shifts never discard the prefix
+  n_keep_ = tokens.size();
+
+  // Already resident in the KV cache
+  if (cached_tokens_.size() >= tokens.size() &&
+      std::equal(tokens.begin(), tokens.end(), cached_tokens_.begin())) {
+    return true;
+  }
+
+  std::string path = StateCachePath(tokens);
+  std::error_code ec;
+
+  // Restore a previously saved state instead of decoding
+  if (!path.empty() && std::filesystem::exists(path, ec)) {
+    ClearCache();
+
+    std::vector<llama_token> loaded(tokens.size());
+    size_t n_loaded = 0;
+    size_t n_read = llama_state_seq_load_file(ctx_, path.c_str(), 0,
+                                              loaded.data(), loaded.size(),
+                                              &n_loaded);
+    if (n_read > 0 && n_loaded == tokens.size() &&
+        std::equal(tokens.begin(), tokens.end(), loaded.begin())) {
+      cached_tokens_ = tokens;
+      // Recently used states survive eviction
+      std::filesystem::last_write_time(
+          path, std::filesystem::file_time_type::clock::now(), ec);
+      return true;
+    }
+
+    // Stale or corrupt: discard it and prefill normally
+    ClearCache();
+    std::filesystem::remove(path, ec);
+  }
+
+  if (!DecodePrompt(tokens)) {
+    return false;
+  }
+
+  if (!path.empty()) {
+    // Write to a temporary name first so concurrent launches never read a
+    // partially written state
+    std::filesystem::create_directories(state_cache_dir_, ec);
+    std::string tmp_path =
+        path + ".tmp" +
+        std::to_string(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+    if (llama_state_seq_save_file(ctx_, tmp_path.c_str(), 0, tokens.data(),
+                                  tokens.size()) > 0) {
+      std::filesystem::rename(tmp_path, path, ec);
+    }
+    if (ec || std::filesystem::exists(tmp_path)) {
+      std::filesystem::remove(tmp_path, ec);
+    }
+    PruneStateCache(state_cache_dir_, path);
+  }
+
+  return true;
+}
+
+bool ModelLoader::EnableSpeculativeDecoding(const std::string &draft_model_path,
+                                            int max_draft) {
+  if (!model_) {
+    return false;
+  }
+
+  auto draft = std::make_unique<ModelLoader>();
+  draft->SetName(name_.empty() ? "draft" : name_ + "-draft");
+  draft->SetStateCacheDir("");
+  draft->residency_managed_ = false;
+  // The draft only sees a window over the recent context (see DraftTokens)
+  if (!draft->Load(draft_model_path, std::min(n_ctx_, MAX_DRAFT_CTX))) {
+    return false;
+  }
+
+  draft_vocab_compatible_ =
+      VocabsCompatible(llama_model_get_vocab(model_),
+                       llama_model_get_vocab(draft->model_));
+  if (!draft_vocab_compatible_) {
+    logging::LogWarn(name_.empty() ? "model" : name_,
+                     "Draft model " + draft_model_path +
+                         " has a different vocabulary; drafts are bridged "
+                         "through text and acceptance will be low");
+  }
+  draft_window_start_ = 0;
+  draft_ = std::move(draft);
+  draft_model_path_ = draft_model_path;
+  max_draft_ = std::max(1, max_draft);
+  n_draft_ = std::min(4, max_draft_);
+  draft_acceptance_ = 0.5f;
+  return true;
+}
+
+void ModelLoader::DisableSpeculativeDecoding() {
+  draft_.reset();
+  draft_model_path_.clear();
+}
+
+bool ModelLoader::Evict() {
+  if (is_resident_ || !model_) {
+    return false;
+  }
+
+  std::string draft_path = draft_model_path_;
+  Unload();
+  draft_model_path_ = draft_path;
+  evicted_ = true;
+  return true;
+}
+
+bool ModelLoader::ShrinkContext() {
+  const int MIN_CTX = 512;
+  if (!model_ || n_ctx_ <= MIN_CTX) {
+    return false;
+  }
+  n_ctx_ = std::max(MIN_CTX, n_ctx_ / 2);
+  if (draft_) {
+    draft_->ShrinkContext();
+  }
+  return CreateContext();
+}
+
+void ModelLoader::EnsureReady() {
+  auto &residency = ResidencyManager::Instance();
+
+  if (evicted_) {
+    std::string draft_path = draft_model_path_;
+    if (Load(model_path_, requested_n_ctx_) && !draft_path.empty()) {
+      EnableSpeculativeDecoding(draft_path, max_draft_);
+    }
+  } else if (model_ && n_ctx_ < requested_n_ctx_ &&
+             !residency.UnderPressure()) {
+    n_ctx_ = requested_n_ctx_;
+    if (draft_) {
+      draft_->n_ctx_ = draft_->requested_n_ctx_;
+      draft_->CreateContext();
+    }
+    CreateContext();
+  }
+
+  if (model_ && residency_managed_) {
+    residency.Touch(this);
+  }
+}
+
+std::vector<llama_token>
+ModelLoader::DraftTokens(const std::vector<llama_token> &context_tokens,
+                         const std::string &context_text, int n) {
+  const llama_vocab *draft_vocab = llama_model_get_vocab(draft_->model_);
+
+  // In the draft's vocab. Bridged text only grows between rounds, so the
+  // draft's token cache tokenizes just the new suffix.
+  std::vector<llama_token> all =
+      draft_vocab_compatible_ ? context_tokens
+                              : draft_->TokenizePrompt(context_text);
+
+  // The draft only needs recent context. Its window over the tail moves in
+  // half-context jumps, so between jumps the draft's prefix cache keeps
+  // each round's decode incremental.
+  const size_t window = std::max(1, draft_->n_ctx_ - n - 1);
+  if (draft_window_start_ > all.size() ||
+      all.size() - draft_window_start_ > window) {
+    draft_window_start_ = all.size() > window / 2 ? all.size() - window / 2 : 0;
+  }
+  std::vector<llama_token> input(all.begin() + draft_window_start_, all.end());
+  if (input.empty() || !draft_->DecodePrompt(input)) {
+    return {};
+  }
+
+  std::vector<llama_token> drafted;
+  std::string drafted_text;
+  const int n_vocab = llama_vocab_n_tokens(draft_vocab);
+
+  for (int i = 0; i < n; ++i) {
+    // Greedy: the draft only has to guess what the target will pick
+    const float *logits = llama_get_logits_ith(draft_->ctx_, -1);
+    llama_token best = std::max_element(logits, logits + n_vocab) - logits;
+    if (llama_token_is_eog(draft_vocab, best)) {
+      break;
+    }
+
+    drafted.push_back(best);
+    drafted_text += draft_->pieces_->Get(best);
+
+    // The last draft token's logits are never needed
+    if (i + 1 < n) {
+      llama_batch batch = llama_batch_get_one(&best, 1);
+      if (llama_decode(draft_->ctx_, batch) != 0) {
+        break;
+      }
+      draft_->cached_tokens_.push_back(best);
+    }
+  }
+
+  if (draft_vocab_compatible_) {
+    return drafted;
+  }
+
+  // Different vocabularies: re-tokenize the drafted text for this model
+  std::vector<llama_token> bridged(drafted_text.size() + 16);
+  int n_bridged = llama_tokenize(llama_model_get_vocab(model_),
+                                 drafted_text.c_str(), drafted_text.size(),
+                                 bridged.data(), bridged.size(), false, false);
+  if (n_bridged <= 0) {
+    return {};
+  }
+  bridged.resize(std::min(n_bridged, n));
+  return bridged;
+}
+
+void ModelLoader::UpdateDraftLength(size_t n_accepted, size_t n_drafted) {
+  float rate = static_cast<float>(n_accepted) / n_drafted;
+  draft_acceptance_ = 0.8f * draft_acceptance_ + 0.2f * rate;
+
+  if (draft_acceptance_ > 0.7f && n_draft_ < max_draft_) {
+    ++n_draft_;
+  } else if (draft_acceptance_ < 0.3f && n_draft_ > 1) {
+    --n_draft_;
+  }
+}
+
+std::vector<llama_token> ModelLoader::TokenizePrompt(const std::string &prompt) {
+  const llama_vocab *vocab = llama_model_get_vocab(model_);
+  std::vector<llama_token> tokens;
+  const size_t n_cached = token_cache_text_.size();
+  if (n_cached > 0 && prompt.size() > n_cached &&
+      prompt.compare(0, n_cached, token_cache_text_) == 0) {
+    // Extends the previous prompt: tokenize only the new suffix
+    std::vector<llama_token> suffix =
+        TokenizeText(vocab, prompt.substr(n_cached), false);
+    if (!suffix.empty()) {
+      tokens = token_cache_tokens_;
+      tokens.insert(tokens.end(), suffix.begin(), suffix.end());
+    }
+  }
+  if (tokens.empty()) {
+    tokens = TokenizeText(vocab, prompt);
+  }
+
+  token_cache_text_ = prompt;
+  token_cache_tokens_ = tokens;
+  return tokens;
+}
+
+int ModelLoader::CountTokens(const std::string &text) {
+  EnsureReady();
+  if (!model_) {
+    return 0;
+  }
+  return TokenizeText(llama_model_get_vocab(model_), text, false).size();
+}
+
+std::string ModelLoader::ForcedText(llama_sampler *grammar, size_t max_len) {
+  const llama_vocab *vocab = llama_model_get_vocab(model_);
+  if (jump_probe_tokens_.empty()) {
+    const int n_vocab = llama_vocab_n_tokens(vocab);
+    for (llama_token tok = 0; tok < n_vocab; ++tok) {
+      if (llama_vocab_is_eog(vocab, tok) || pieces_->Get(tok).size() == 1) {
+        jump_probe_tokens_.push_back(tok);
+      }
+    }
+  }
+
+  // The next character is forced when the grammar allows exactly one
+  // single-character token and does not allow ending the generation
+  std::string forced;
+  std::vector<llama_token_data> candidates(jump_probe_tokens_.size());
+  while (forced.size() < max_len) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      candidates[i] = {jump_probe_tokens_[i], 0.0f, 0.0f};
+    }
+    llama_token_data_array cur_p = {candidates.data(), candidates.size(), -1,
+                                    false};
+    llama_sampler_apply(grammar, &cur_p);
+
+    llama_token only = -1;
+    int n_allowed = 0;
+    for (size_t i = 0; i < cur_p.size && n_allowed < 2; ++i) {
+      if (std::isfinite(cur_p.data[i].logit)) {
+        only = cur_p.data[i].id;
+        ++n_allowed;
+      }
+    }
+    if (n_allowed != 1 || llama_vocab_is_eog(vocab, only)) {
+      break;
+    }
+
+    // Grammar literals are ASCII; never stop inside a UTF-8 sequence
+    char c = pieces_->Get(only)[0];
+    if (c & 0x80) {
+      break;
+    }
+    llama_sampler_accept(grammar, only);
+    forced += c;
+  }
+  return forced;
+}
+
+bool ModelLoader::ShiftContext(int n_needed) {
+  llama_memory_t mem = llama_get_memory(ctx_);
+  if (!llama_memory_can_shift(mem)) {
+    return false;
+  }
+
+  // Always keep the first token (BOS) even without a warmed prefix
+  const int n_past = cached_tokens_.size();
+  const int n_keep = std::min<int>(std::max<size_t>(n_keep_, 1), n_past);
+  const int n_discard = (n_past - n_keep) / 2;
+  if (n_discard <= 0 || n_past - n_discard + n_needed > n_ctx_) {
+    return false;
+  }
+
+  if (!llama_memory_seq_rm(mem, 0, n_keep, n_keep + n_discard)) {
+    return false;
+  }
+  llama_memory_seq_add(mem, 0, n_keep + n_discard, n_past, -n_discard);
+  cached_tokens_.erase(cached_tokens_.begin() + n_keep,
+                       cached_tokens_.begin() + n_keep + n_discard);
+  return true;
+}
+
+void ModelLoader::ClearCache() {
+  if (ctx_) {
+    llama_memory_clear(llama_get_memory(ctx_), true);
+  }
+  cached_tokens_.clear();
+}
+
 void ModelLoader::Unload() {
   // Don't unload if resident
   if (is_resident_) {
     return;
   }
 
+  ResidencyManager::Instance().Unregister(this);
+  evicted_ = false;
+  draft_.reset();
+
   if (sampler_) {
     llama_sampler_free(sampler_);
     sampler_ = nullptr;
   }
 
   if (ctx_) {
+    ModelRegistry::Instance().UnregisterContext(ctx_);
     llama_free(ctx_);
     ctx_ = nullptr;
   }
+  cached_tokens_.clear();
+  jump_probe_tokens_.clear();
+  token_cache_text_.clear();
+  token_cache_tokens_.clear();
 
-  if (model_) {
-    llama_free_model(model_);
-    model_ = nullptr;
-  }
+  // Release our reference; the weights are freed once no loader uses them
+  pieces_.reset();
+  model_handle_.reset();
+  model_ = nullptr;
+}
+
+llama_sampler *ModelLoader::CreateSamplerChain(const std::string &grammar) {
+  return GrammarCache::Instance().CreateChain(llama_model_get_vocab(model_),
+                                              grammar);
 }
 
 std::string ModelLoader::Infer(const std::string &prompt,
                                const std::string &grammar, int max_tokens,
                                std::function<void(const std::string &)> stream_callback,
                                std::atomic<bool>* interrupt_flag) {
+  InferRequest request;
+  request.prompt = prompt;
+  request.grammar = grammar;
+  request.max_tokens = max_tokens;
+  request.stream_callback = stream_callback;
+  return Infer(request, interrupt_flag);
+}
+
+std::string ModelLoader::Infer(const InferRequest &request,
+                               std::atomic<bool>* interrupt_flag) {
+  EnsureReady();
   if (!model_ || !ctx_) {
     return "[Error: Model not loaded]";
   }
 
-  return RunInference(prompt, grammar, max_tokens, stream_callback, interrupt_flag);
+  return RunInference(request, interrupt_flag);
 }
 
-std::string ModelLoader::RunInference(const std::string &prompt,
-                                      const std::string &grammar,
-                                      int max_tokens,
-                                      std::function<void(const std::string &)> stream_callback,
+std::string ModelLoader::RunInference(const InferRequest &request,
                                       std::atomic<bool>* interrupt_flag) {
-  // Recreate context to clear KV cache (prevents overflow on repeated calls)
-  if (ctx_) {
-    llama_free(ctx_);
-    ctx_ = nullptr;
-  }
+  const std::string &prompt = request.prompt;
+  const std::string &grammar = request.grammar;
+  const int max_tokens = request.max_tokens;
+  const auto &stream_callback = request.stream_callback;
 
-  llama_context_params ctx_params = llama_context_default_params();
-  ctx_params.n_ctx = n_ctx_;
-  ctx_params.n_batch = 512;
-  ctx_params.n_threads = 4;
-  ctx_ = llama_new_context_with_model(model_, ctx_params);
+  using Clock = std::chrono::steady_clock;
+  auto ms_since = [](Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start)
+        .count();
+  };
+  const auto call_start = Clock::now();
+  last_stats_ = InferenceStats();
+  last_stats_.grammar_active = !grammar.empty();
 
-  if (!ctx_) {
-    return "[Error: Failed to recreate context]";
+  // Without prefix caching, start every call from an empty context
+  if (!prefix_caching_) {
+    auto start = Clock::now();
+    if (!CreateContext()) {
+      return "[Error: Failed to recreate context]";
+    }
+    last_stats_.context_recreate_ms = ms_since(start);
   }
 
   // Tokenize
-  std::vector<llama_token> tokens;
-  tokens.resize(prompt.size() + 16);
   const llama_vocab *vocab = llama_model_get_vocab(model_);
-  int n_tokens = llama_tokenize(vocab, prompt.c_str(), prompt.size(),
-                                tokens.data(), tokens.size(), true, true);
-  if (n_tokens < 0)
+  std::vector<llama_token> tokens = TokenizePrompt(prompt);
+  if (tokens.empty())
     return "[Error: Tokenization failed]";
-  tokens.resize(n_tokens);
+  last_stats_.prompt_tokens = tokens.size();
 
-  // Evaluate
-  llama_batch batch = llama_batch_get_one(tokens.data(), n_tokens);
-  if (llama_decode(ctx_, batch) != 0)
+  // Evaluate (only the part not already in the KV cache)
+  auto prefill_start = Clock::now();
+  bool prefilled = DecodePrompt(tokens, interrupt_flag);
+  last_stats_.prefill_ms = ms_since(prefill_start);
+  if (!prefilled) {
+    if (interrupt_flag && interrupt_flag->load()) {
+      if (stream_callback) {
+        stream_callback("\n[interrupted]");
+      }
+      return "\n[interrupted]";
+    }
     return "[Error: Decode failed]";
+  }
 
   // If grammar provided, create a temporary sampler with grammar constraint
   llama_sampler* active_sampler = sampler_;
   llama_sampler* grammar_sampler = nullptr;
 
   if (!grammar.empty()) {
-    auto sparams = llama_sampler_chain_default_params();
-    grammar_sampler = llama_sampler_chain_init(sparams);
-
+    grammar_sampler = CreateSamplerChain(grammar);
     if (grammar_sampler) {
-      // Try to create grammar sampler
-      llama_sampler* gs = llama_sampler_init_grammar(vocab, grammar.c_str(), "root");
-      if (gs) {
-        llama_sampler_chain_add(grammar_sampler, gs);
-      }
-      // Add standard samplers
-      llama_sampler_chain_add(grammar_sampler, llama_sampler_init_top_k(40));
-      llama_sampler_chain_add(grammar_sampler, llama_sampler_init_top_p(0.95f, 1));
-      llama_sampler_chain_add(grammar_sampler, llama_sampler_init_temp(0.7f));
-      llama_sampler_chain_add(grammar_sampler, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
-
       active_sampler = grammar_sampler;
     }
   }
 
-  // Generate tokens with streaming display
-  std::string result;
-  int line_length = 0;
-  const int MAX_LINE_LENGTH = 80;
+  // Generate tokens. The stream carries the raw model text in batches;
+  // wrapping for display is up to the UI.
+  std::string result;   // Generated text released by the stop matcher
+  std::string raw_text; // Everything generated, including held-back text
+  int n_generated = 0;
+  StreamSink sink(stream_callback);
+
+  auto display = [&](std::string_view text) {
+    result += text;
+    sink.Write(text);
+  };
 
-  for (int i = 0; i < max_tokens; ++i) {
+  // Text that may be the start of a stop sequence is held back by matcher
+  StopSequenceMatcher matcher(request.stop);
+  auto emit = [&](llama_token tok) {
+    std::string_view piece = pieces_->Get(tok);
+    raw_text += piece;
+    display(matcher.Feed(piece));
+  };
+
+  // Checked after every emitted token, before it is decoded
+  auto should_stop = [&]() {
+    return matcher.Matched() ||
+           (request.stop_when && request.stop_when(raw_text));
+  };
+  bool stopped = false;
+
+  const bool speculative = draft_ && draft_->IsLoaded();
+  llama_sampler *grammar_stage = GrammarCache::GrammarStage(grammar_sampler);
+  llama_memory_t mem = llama_get_memory(ctx_);
+  llama_batch batch = llama_batch_init(
+      std::max<int>(max_draft_, MAX_FORCED_CHARS) + 1, 0, 1);
+
+  active_interrupt_ = interrupt_flag;
+
+  auto sample = [&](int idx) {
+    auto start = Clock::now();
+    llama_token tok = llama_sampler_sample(active_sampler, ctx_, idx);
+    last_stats_.sample_ms += ms_since(start);
+    return tok;
+  };
+
+  // The sampled token that still has to be decoded
+  llama_token pending = sample(-1);
+  last_stats_.ttft_ms = ms_since(call_start);
+  const auto decode_start = Clock::now();
+
+  while (n_generated < max_tokens && !stopped) {
     // Check if interrupted
     if (interrupt_flag && interrupt_flag->load()) {
-      if (stream_callback) {
-        stream_callback("\n[interrupted]");
-      }
-      result += "\n[interrupted]";
+      display(matcher.Flush());
+      display("\n[interrupted]");
 
       // Reset sampler to prevent continuation
       llama_sampler_reset(active_sampler);
@@ -194,47 +1105,140 @@ std::string ModelLoader::RunInference(const std::string &prompt,
       break;
     }
 
-    llama_token tok = llama_sampler_sample(active_sampler, ctx_, -1);
+    if (llama_token_is_eog(vocab, pending))
+      break;
 
-    if (llama_token_is_eog(vocab, tok))
+    emit(pending);
+    ++n_generated;
+    if (should_stop())
       break;
 
-    char buf[256];
-    int n = llama_token_to_piece(vocab, tok, buf, sizeof(buf), 0, false);
-    if (n > 0) {
-      std::string token_str(buf, n);
-
-      // Word wrap: insert newline if line gets too long
-      if (line_length + token_str.length() > MAX_LINE_LENGTH) {
-        // If token starts with space, replace it with newline
-        if (!token_str.empty() && token_str[0] == ' ') {
-          token_str[0] = '\n';
-          line_length = 0;
-        }
-        // Otherwise if it's a long word or we can't find a space, force wrap
-        else if (line_length > 0) {
-          if (stream_callback) stream_callback("\n");
-          result += "\n";
-          line_length = 0;
+    // Jump forward over text the grammar forces (e.g. "CMD: "): decode it
+    // in the same batch as the pending token instead of sampling it
+    std::vector<llama_token> forced;
+    if (grammar_stage && n_generated < max_tokens) {
+      std::string text = ForcedText(grammar_stage, MAX_FORCED_CHARS);
+      if (!text.empty()) {
+        forced.resize(text.size());
+        int n = llama_tokenize(vocab, text.c_str(), text.size(), forced.data(),
+                               forced.size(), false, false);
+        forced.resize(std::max(0, std::min(n, max_tokens - n_generated)));
+        for (llama_token tok : forced) {
+          emit(tok);
+          ++n_generated;
         }
+        last_stats_.forced_tokens += forced.size();
+        if (should_stop())
+          break;
       }
+    }
 
-      result += token_str;
-      line_length += token_str.length();
-
-      // Reset line counter on newlines
-      if (token_str.find('\n') != std::string::npos) {
-        line_length = 0;
-      }
+    // Let the draft model guess the next few tokens
+    std::vector<llama_token> draft;
+    if (speculative && forced.empty() && n_generated < max_tokens) {
+      std::vector<llama_token> context = cached_tokens_;
+      context.push_back(pending);
+      draft = DraftTokens(context, prompt + raw_text,
+                          std::min(n_draft_, max_tokens - n_generated));
+    }
 
-      if (stream_callback) {
-        stream_callback(token_str);
-      }
+    // Out of context: shift instead of failing the decode below
+    std::vector<llama_token> step = {pending};
+    step.insert(step.end(), forced.begin(), forced.end());
+    const int n_needed = step.size() + draft.size();
+    if ((int)cached_tokens_.size() + n_needed > n_ctx_) {
+      if (!context_shift_ || !ShiftContext(n_needed))
+        break;
+      ++last_stats_.context_shifts;
     }
 
-    batch = llama_batch_get_one(&tok, 1);
+    // Decode the pending and forced tokens and the draft in one batch
+    step.insert(step.end(), draft.begin(), draft.end());
+    int n_past = cached_tokens_.size();
+    batch.n_tokens = 0;
+    for (size_t i = 0; i < step.size(); ++i) {
+      int k = batch.n_tokens++;
+      batch.token[k] = step[i];
+      batch.pos[k] = n_past + i;
+      batch.n_seq_id[k] = 1;
+      batch.seq_id[k][0] = 0;
+      batch.logits[k] = !draft.empty() || i + 1 == step.size();
+    }
     if (llama_decode(ctx_, batch) != 0)
       break;
+    cached_tokens_.push_back(pending);
+    cached_tokens_.insert(cached_tokens_.end(), forced.begin(), forced.end());
+
+    if (n_generated >= max_tokens)
+      break;
+
+    // Sample the target model at each drafted position and keep the draft
+    // for as long as it agrees. Every token still comes from the target's
+    // own sampler (grammar included), so the output distribution is
+    // unchanged; the first disagreement becomes the next pending token.
+    size_t n_accepted = 0;
+    for (size_t i = 0;; ++i) {
+      pending = sample(draft.empty() ? -1 : (int)i);
+      bool agrees = i < draft.size() && pending == draft[i];
+      if (!agrees || n_generated >= max_tokens ||
+          llama_token_is_eog(vocab, pending) ||
+          (interrupt_flag && interrupt_flag->load())) {
+        break;
+      }
+      emit(pending);
+      ++n_generated;
+      cached_tokens_.push_back(pending);
+      ++n_accepted;
+      if (should_stop()) {
+        stopped = true;
+        break;
+      }
+    }
+
+    if (!draft.empty()) {
+      // Drop the KV entries of rejected draft tokens
+      llama_memory_seq_rm(mem, 0, cached_tokens_.size(), -1);
+      UpdateDraftLength(n_accepted, draft.size());
+      last_stats_.drafted_tokens += draft.size();
+      last_stats_.accepted_tokens += n_accepted;
+    }
+  }
+  active_interrupt_ = nullptr;
+  llama_batch_free(batch);
+  if (!matcher.Matched()) {
+    display(matcher.Flush());
+  }
+  sink.Flush();
+
+  // Entries after the kept prefix were computed against tokens that have
+  // since been discarded; don't let a later prompt reuse them
+  if (last_stats_.context_shifts > 0) {
+    size_t n_keep = std::min(n_keep_, cached_tokens_.size());
+    llama_memory_seq_rm(mem, 0, n_keep, -1);
+    cached_tokens_.resize(n_keep);
+  } else if (cached_tokens_.size() > tokens.size()) {
+    // A follow-up prompt that quotes this output (an agent transcript)
+    // then only tokenizes what comes after it
+    for (size_t i = tokens.size(); i < cached_tokens_.size(); ++i) {
+      token_cache_text_ += pieces_->Get(cached_tokens_[i]);
+      token_cache_tokens_.push_back(cached_tokens_[i]);
+    }
+  }
+
+  last_stats_.generated_tokens = n_generated;
+  last_stats_.decode_ms = ms_since(decode_start);
+
+  if (logging::Logger::Instance().GetLevel() <= logging::LogLevel::Info) {
+    char line[192];
+    std::snprintf(line, sizeof(line),
+                  "%d prompt tokens (%d prefilled, %.1f tok/s), ttft %.0f ms, "
+                  "%d generated at %.1f tok/s, %d forced, %d/%d drafts",
+                  last_stats_.prompt_tokens, last_stats_.prefill_tokens,
+                  last_stats_.PrefillTokensPerSec(), last_stats_.ttft_ms,
+                  last_stats_.generated_tokens,
+                  last_stats_.DecodeTokensPerSec(), last_stats_.forced_tokens,
+                  last_stats_.accepted_tokens, last_stats_.drafted_tokens);
+    logging::LogInfo(name_.empty() ? "infer" : name_, line);
   }
 
   // Clean up grammar sampler if we created one
@@ -244,5 +1248,243 @@ std::string ModelLoader::RunInference(const std::string &prompt,
 
   return result;
 }
+
+std::vector<float>
+ModelLoader::ScoreLabels(const std::string &prompt,
+                         const std::vector<std::string> &labels) {
+  EnsureReady();
+  if (!model_ || !ctx_ || labels.empty()) {
+    return {};
+  }
+  if (!prefix_caching_ && !CreateContext()) {
+    return {};
+  }
+
+  const llama_vocab *vocab = llama_model_get_vocab(model_);
+  std::vector<llama_token> tokens = TokenizeText(vocab, prompt);
+  if (tokens.empty() || !DecodePrompt(tokens)) {
+    return {};
+  }
+
+  // First token of each label as it would continue the prompt (no BOS)
+  std::vector<llama_token> first_tokens;
+  for (const auto &label : labels) {
+    std::vector<llama_token> label_tokens(label.size() + 1);
+    if (llama_tokenize(vocab, label.c_str(), label.size(),
+                       label_tokens.data(), label_tokens.size(), false,
+                       false) <= 0) {
+      return {};
+    }
+    llama_token tok = label_tokens[0];
+    if (std::find(first_tokens.begin(), first_tokens.end(), tok) !=
+        first_tokens.end()) {
+      return {};
+    }
+    first_tokens.push_back(tok);
+  }
+
+  const float *logits = llama_get_logits_ith(ctx_, -1);
+  if (!logits) {
+    return {};
+  }
+
+  // Softmax over the label logits only
+  float max_logit = logits[first_tokens[0]];
+  for (llama_token tok : first_tokens) {
+    max_logit = std::max(max_logit, logits[tok]);
+  }
+  std::vector<float> probs;
+  float sum = 0.0f;
+  for (llama_token tok : first_tokens) {
+    probs.push_back(std::exp(logits[tok] - max_logit));
+    sum += probs.back();
+  }
+  for (float &p : probs) {
+    p /= sum;
+  }
+  return probs;
+}
+
+int ModelLoader::GetMaxParallelSequences() { return MAX_BATCH_SEQUENCES; }
+
+std::vector<std::string>
+ModelLoader::InferBatch(const std::vector<InferRequest> &requests,
+                        std::atomic<bool> *interrupt_flag) {
+  std::vector<std::string> results(requests.size());
+  EnsureReady();
+  if (!model_ || !ctx_) {
+    std::fill(results.begin(), results.end(), "[Error: Model not loaded]");
+    return results;
+  }
+
+  const llama_vocab *vocab = llama_model_get_vocab(model_);
+  llama_memory_t mem = llama_get_memory(ctx_);
+
+  // One decoding sequence; seq_id is fixed per slot
+  struct Slot {
+    llama_seq_id seq_id = 0;
+    bool active = false;
+    size_t request = 0;
+    llama_sampler *sampler = nullptr;
+    std::vector<llama_token> prompt;
+    size_t n_prompt_done = 0;  // Prompt tokens decoded so far
+    int n_past = 0;            // Next position in the sequence
+    int n_generated = 0;
+    llama_token pending = 0;   // Sampled token still to be decoded
+    int logits_index = -1;     // Batch index of this slot's logits
+    StopSequenceMatcher matcher;
+    std::unique_ptr<StreamSink> sink;
+    std::string raw;           // Generated text, including held-back text
+  };
+
+  std::vector<Slot> slots(MAX_BATCH_SEQUENCES);
+  for (int i = 0; i < MAX_BATCH_SEQUENCES; ++i) {
+    slots[i].seq_id = i + 1;
+  }
+
+  auto release = [&](Slot &slot, std::string_view text) {
+    results[slot.request] += text;
+    slot.sink->Write(text);
+  };
+
+  auto finish = [&](Slot &slot) {
+    release(slot, slot.matcher.Flush());
+    slot.sink->Flush();
+    llama_memory_seq_rm(mem, slot.seq_id, -1, -1);
+    if (slot.sampler) {
+      llama_sampler_free(slot.sampler);
+      slot.sampler = nullptr;
+    }
+    slot.active = false;
+  };
+
+  size_t next_request = 0;
+  bool evicted_prefix = false;
+  llama_batch batch = llama_batch_init(n_batch_, 0, 1);
+
+  active_interrupt_ = interrupt_flag;
+
+  while (true) {
+    if (interrupt_flag && interrupt_flag->load()) {
+      for (auto &slot : slots) {
+        if (slot.active) {
+          finish(slot);
+          results[slot.request] += "\n[interrupted]";
+        }
+      }
+      break;
+    }
+
+    // Admit waiting requests into free slots
+    for (auto &slot : slots) {
+      while (!slot.active && next_request < requests.size()) {
+        const InferRequest &req = requests[next_request];
+        size_t index = next_request++;
+
+        std::vector<llama_token> tokens = TokenizeText(vocab, req.prompt);
+        if (tokens.empty()) {
+          results[index] = "[Error: Tokenization failed]";
+          continue;
+        }
+        if ((int)tokens.size() >= n_ctx_) {
+          results[index] = "[Error: Prompt too long]";
+          continue;
+        }
+
+        slot.active = true;
+        slot.request = index;
+        slot.sampler = CreateSamplerChain(req.grammar);
+        slot.prompt = std::move(tokens);
+        slot.n_prompt_done = 0;
+        slot.n_past = 0;
+        slot.n_generated = 0;
+        slot.logits_index = -1;
+        slot.matcher = StopSequenceMatcher(req.stop);
+        slot.sink = std::make_unique<StreamSink>(req.stream_callback);
+        slot.raw.clear();
+      }
+    }
+
+    // Build one batch: a single token for every generating slot, then
+    // prompt chunks from prefilling slots in the remaining space
+    batch.n_tokens = 0;
+    auto add = [&](Slot &slot, llama_token tok, bool logits) {
+      int k = batch.n_tokens++;
+      batch.token[k] = tok;
+      batch.pos[k] = slot.n_past++;
+      batch.n_seq_id[k] = 1;
+      batch.seq_id[k][0] = slot.seq_id;
+      batch.logits[k] = logits;
+      if (logits) {
+        slot.logits_index = k;
+      }
+    };
+
+    for (auto &slot : slots) {
+      slot.logits_index = -1;
+      if (slot.active && slot.n_prompt_done == slot.prompt.size()) {
+        add(slot, slot.pending, true);
+      }
+    }
+    for (auto &slot : slots) {
+      while (slot.active && slot.n_prompt_done < slot.prompt.size() &&
+             batch.n_tokens < n_batch_) {
+        bool last = slot.n_prompt_done + 1 == slot.prompt.size();
+        add(slot, slot.prompt[slot.n_prompt_done++], last);
+      }
+    }
+
+    if (batch.n_tokens == 0) {
+      break; // Nothing active and nothing waiting
+    }
+
+    int status = llama_decode(ctx_, batch);
+    if (status == 1 && !evicted_prefix && !cached_tokens_.empty()) {
+      // No room in the KV cache: give up the prefix cache and retry
+      llama_memory_seq_rm(mem, 0, -1, -1);
+      cached_tokens_.clear();
+      evicted_prefix = true;
+      status = llama_decode(ctx_, batch);
+    }
+    if (status != 0) {
+      for (auto &slot : slots) {
+        if (slot.active) {
+          finish(slot);
+          results[slot.request] += "[Error: Decode failed]";
+        }
+      }
+      continue; // Waiting requests start from an emptier cache
+    }
+
+    // Sample every slot that produced logits this step
+    for (auto &slot : slots) {
+      if (!slot.active || slot.logits_index < 0) {
+        continue;
+      }
+      const InferRequest &req = requests[slot.request];
+
+      llama_token tok =
+          llama_sampler_sample(slot.sampler, ctx_, slot.logits_index);
+      if (llama_token_is_eog(vocab, tok)) {
+        finish(slot);
+        continue;
+      }
+
+      std::string_view piece = pieces_->Get(tok);
+      slot.raw += piece;
+      release(slot, slot.matcher.Feed(piece));
+
+      slot.pending = tok;
+      if (++slot.n_generated >= req.max_tokens || slot.n_past >= n_ctx_ ||
+          slot.matcher.Matched() || (req.stop_when && req.stop_when(slot.raw))) {
+        finish(slot);
+      }
+    }
+  }
+  active_interrupt_ = nullptr;
+  llama_batch_free(batch);
+
+  return results;
+}
 } // namespace models
 } // namespace zweek
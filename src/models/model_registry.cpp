@@ -0,0 +1,211 @@
+#include "models/model_registry.hpp"
+#include "logging/logger.hpp"
+#include "models/grammar_cache.hpp"
+#include "models/piece_table.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <llama.h>
+
+namespace zweek {
+namespace models {
+
+namespace {
+
+std::string MakeKey(const std::string &model_path, const ModelParams &params) {
+  std::error_code ec;
+  std::string path =
+      std::filesystem::weakly_canonical(model_path, ec).string();
+  if (ec) {
+    path = model_path;
+  }
+  return path + "|gpu=" + std::to_string(params.n_gpu_layers) +
+         "|mmap=" + std::to_string(params.use_mmap) +
+         "|mlock=" + std::to_string(params.use_mlock);
+}
+
+// Read an integer GGUF metadata value, or fallback if missing
+long MetaInt(const llama_model *model, const std::string &key, long fallback) {
+  char buf[64];
+  if (llama_model_meta_val_str(model, key.c_str(), buf, sizeof(buf)) < 0) {
+    return fallback;
+  }
+  char *end = nullptr;
+  long value = std::strtol(buf, &end, 10);
+  return end != buf ? value : fallback;
+}
+
+std::string FormatMiB(uint64_t bytes) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.1f MiB", bytes / (1024.0 * 1024.0));
+  return buf;
+}
+
+} // namespace
+
+ModelRegistry &ModelRegistry::Instance() {
+  static ModelRegistry instance;
+  return instance;
+}
+
+std::shared_ptr<llama_model>
+ModelRegistry::Acquire(const std::string &model_path,
+                       const ModelParams &params) {
+  std::string key = MakeKey(model_path, params);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Already loaded by another consumer
+  auto it = models_.find(key);
+  if (it != models_.end()) {
+    if (auto handle = it->second.handle.lock()) {
+      return handle;
+    }
+  }
+
+  llama_model_params model_params = llama_model_default_params();
+  model_params.n_gpu_layers = params.n_gpu_layers;
+  model_params.use_mmap = params.use_mmap;
+  model_params.use_mlock = params.use_mlock;
+
+  llama_model *model =
+      llama_model_load_from_file(model_path.c_str(), model_params);
+  if (!model) {
+    logging::LogError("model", "Failed to load model: " + model_path);
+    return nullptr;
+  }
+
+  std::shared_ptr<llama_model> handle(
+      model, [this, key](llama_model *m) { Release(key, m); });
+
+  ModelEntry entry;
+  entry.path = model_path;
+  entry.model = model;
+  entry.handle = handle;
+  models_[key] = entry;
+
+  return handle;
+}
+
+bool ModelRegistry::IsLoaded(const std::string &model_path,
+                             const ModelParams &params) {
+  std::string key = MakeKey(model_path, params);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = models_.find(key);
+  return it != models_.end() && !it->second.handle.expired();
+}
+
+void ModelRegistry::Release(const std::string &key, llama_model *model) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The key may already point at a newer load of the same file
+    auto it = models_.find(key);
+    if (it != models_.end() && it->second.model == model) {
+      models_.erase(it);
+    }
+  }
+  // Cached grammars and piece tables are keyed by the model's vocab
+  GrammarCache::Instance().Evict(llama_model_get_vocab(model));
+  PieceTable::Evict(llama_model_get_vocab(model));
+  llama_model_free(model);
+}
+
+void ModelRegistry::RegisterContext(const llama_context *ctx,
+                                    const llama_model *model,
+                                    const std::string &owner, int n_ctx,
+                                    uint64_t kv_bytes,
+                                    const std::string &kv_type) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ContextEntry entry;
+  entry.model = model;
+  entry.info.owner = owner;
+  entry.info.n_ctx = n_ctx;
+  entry.info.kv_bytes = kv_bytes;
+  entry.info.kv_type = kv_type;
+  contexts_[ctx] = entry;
+}
+
+void ModelRegistry::UnregisterContext(const llama_context *ctx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  contexts_.erase(ctx);
+}
+
+std::vector<ModelMemoryInfo> ModelRegistry::GetMemoryReport() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<ModelMemoryInfo> report;
+  for (const auto &[key, entry] : models_) {
+    ModelMemoryInfo info;
+    info.path = entry.path;
+    info.weights_bytes = llama_model_size(entry.model);
+    info.ref_count = entry.handle.use_count();
+
+    for (const auto &[ctx, ctx_entry] : contexts_) {
+      if (ctx_entry.model == entry.model) {
+        info.contexts.push_back(ctx_entry.info);
+      }
+    }
+    report.push_back(info);
+  }
+  return report;
+}
+
+std::string ModelRegistry::FormatMemoryReport() {
+  auto report = GetMemoryReport();
+  if (report.empty()) {
+    return "No models loaded.";
+  }
+
+  uint64_t total = 0;
+  std::string output = "Model memory:\n";
+  for (const auto &model : report) {
+    output += "  " + model.path + "  weights " +
+              FormatMiB(model.weights_bytes) + " (" +
+              std::to_string(model.ref_count) + " user" +
+              (model.ref_count == 1 ? "" : "s") + ")\n";
+    total += model.weights_bytes;
+
+    for (const auto &ctx : model.contexts) {
+      output += "    " + (ctx.owner.empty() ? "context" : ctx.owner) +
+                "  n_ctx " + std::to_string(ctx.n_ctx) + "  KV " +
+                FormatMiB(ctx.kv_bytes) +
+                (ctx.kv_type.empty() ? "" : " (" + ctx.kv_type + ")") + "\n";
+      total += ctx.kv_bytes;
+    }
+  }
+  output += "  Total: " + FormatMiB(total);
+  return output;
+}
+
+uint64_t ModelRegistry::EstimateKvCacheBytes(const llama_model *model,
+                                             int n_ctx, int type_k,
+                                             int type_v) {
+  if (!model || n_ctx <= 0) {
+    return 0;
+  }
+
+  // Prefer the GGUF metadata: some models (e.g. Qwen3) use a head size
+  // that differs from n_embd / n_head
+  char arch[64] = {0};
+  llama_model_meta_val_str(model, "general.architecture", arch, sizeof(arch));
+  std::string prefix = std::string(arch) + ".";
+
+  int n_head = std::max(1, llama_model_n_head(model));
+  long n_layer = MetaInt(model, prefix + "block_count",
+                         llama_model_n_layer(model));
+  long n_head_kv = MetaInt(model, prefix + "attention.head_count_kv",
+                           llama_model_n_head_kv(model));
+  long head_k = MetaInt(model, prefix + "attention.key_length",
+                        llama_model_n_embd(model) / n_head);
+  long head_v = MetaInt(model, prefix + "attention.value_length", head_k);
+
+  uint64_t k_row = ggml_row_size(static_cast<ggml_type>(type_k),
+                                 head_k * n_head_kv * (int64_t)n_ctx);
+  uint64_t v_row = ggml_row_size(static_cast<ggml_type>(type_v),
+                                 head_v * n_head_kv * (int64_t)n_ctx);
+  return n_layer * (k_row + v_row);
+}
+
+} // namespace models
+} // namespace zweek
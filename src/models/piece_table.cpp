@@ -0,0 +1,53 @@
+#include "models/piece_table.hpp"
+#include <map>
+#include <mutex>
+#include <llama.h>
+
+namespace zweek {
+namespace models {
+
+namespace {
+
+std::mutex tables_mutex;
+std::map<const llama_vocab *, std::shared_ptr<const PieceTable>> tables;
+
+} // namespace
+
+std::shared_ptr<const PieceTable> PieceTable::For(const llama_vocab *vocab) {
+  std::lock_guard<std::mutex> lock(tables_mutex);
+  auto it = tables.find(vocab);
+  if (it == tables.end()) {
+    std::shared_ptr<const PieceTable> table(new PieceTable(vocab));
+    it = tables.emplace(vocab, table).first;
+  }
+  return it->second;
+}
+
+void PieceTable::Evict(const llama_vocab *vocab) {
+  std::lock_guard<std::mutex> lock(tables_mutex);
+  tables.erase(vocab);
+}
+
+PieceTable::PieceTable(const llama_vocab *vocab) {
+  const int n_vocab = llama_vocab_n_tokens(vocab);
+  offsets_.reserve(n_vocab + 1);
+  text_.reserve(n_vocab * 6);
+
+  std::string buf(64, '\0');
+  for (llama_token tok = 0; tok < n_vocab; ++tok) {
+    offsets_.push_back(text_.size());
+    int n = llama_token_to_piece(vocab, tok, buf.data(), buf.size(), 0, false);
+    if (n < 0) {
+      // Buffer too small: -n is the required size
+      buf.resize(-n);
+      n = llama_token_to_piece(vocab, tok, buf.data(), buf.size(), 0, false);
+    }
+    if (n > 0) {
+      text_.append(buf.data(), n);
+    }
+  }
+  offsets_.push_back(text_.size());
+}
+
+} // namespace models
+} // namespace zweek
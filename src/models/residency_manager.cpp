@@ -0,0 +1,220 @@
+#include "models/residency_manager.hpp"
+#include "logging/logger.hpp"
+#include "models/model_loader.hpp"
+#include "models/model_registry.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace zweek {
+namespace models {
+
+namespace {
+
+constexpr uint64_t MiB = 1024ULL * 1024ULL;
+constexpr uint64_t DEFAULT_BUDGET = 3072ULL * MiB;
+
+// Pressure thresholds
+constexpr uint64_t MIN_AVAILABLE = 256ULL * MiB;
+constexpr float MIN_AVAILABLE_FRACTION = 0.05f;
+constexpr float PSI_SOME_AVG10_LIMIT = 10.0f;
+
+std::string FormatMiB(uint64_t bytes) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.0f MiB", bytes / (double)MiB);
+  return buf;
+}
+
+} // namespace
+
+ResidencyManager &ResidencyManager::Instance() {
+  static ResidencyManager instance;
+  return instance;
+}
+
+ResidencyManager::ResidencyManager() {
+  const char *env = getenv("ZWEEK_MEMORY_BUDGET_MB");
+  if (env && std::atoll(env) > 0) {
+    budget_bytes_ = std::atoll(env) * MiB;
+    return;
+  }
+
+  budget_bytes_ = DEFAULT_BUDGET;
+  MemoryPressure pressure = ReadSystemPressure();
+  if (pressure.total_bytes > 0) {
+    budget_bytes_ = std::min(budget_bytes_, pressure.total_bytes / 4 * 3);
+  }
+}
+
+void ResidencyManager::Register(ModelLoader *loader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  last_used_[loader] = std::chrono::steady_clock::now();
+}
+
+void ResidencyManager::Unregister(ModelLoader *loader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  last_used_.erase(loader);
+}
+
+void ResidencyManager::Touch(ModelLoader *loader) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = last_used_.find(loader);
+  if (it != last_used_.end()) {
+    it->second = std::chrono::steady_clock::now();
+  }
+}
+
+uint64_t ResidencyManager::CurrentUsage() {
+  uint64_t total = 0;
+  for (const auto &model : ModelRegistry::Instance().GetMemoryReport()) {
+    total += model.weights_bytes;
+    for (const auto &ctx : model.contexts) {
+      total += ctx.kv_bytes;
+    }
+  }
+  return total;
+}
+
+ModelLoader *ResidencyManager::PickVictim(const ModelLoader *requester) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ModelLoader *victim = nullptr;
+  std::chrono::steady_clock::time_point oldest;
+  for (const auto &[loader, used] : last_used_) {
+    if (loader == requester || loader->IsResident() || !loader->IsLoaded()) {
+      continue;
+    }
+    if (!victim || used < oldest) {
+      victim = loader;
+      oldest = used;
+    }
+  }
+  return victim;
+}
+
+void ResidencyManager::MakeRoom(const ModelLoader *requester,
+                                uint64_t incoming_bytes) {
+  while (CurrentUsage() + incoming_bytes > budget_bytes_) {
+    ModelLoader *victim = PickVictim(requester);
+    if (!victim || !victim->Evict()) {
+      break; // Nothing left to evict; the load goes ahead over budget
+    }
+    ++evictions_;
+    logging::LogInfo("residency", "Evicted " + victim->GetName() +
+                                      " to stay within the memory budget");
+  }
+}
+
+bool ResidencyManager::UnderPressure() {
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_pressure_read_ > std::chrono::seconds(1)) {
+    last_pressure_ = ReadSystemPressure();
+    last_pressure_read_ = now;
+  }
+  return last_pressure_.under_pressure;
+}
+
+bool ResidencyManager::CheckPressure() {
+  // Over budget (e.g. after SetBudgetBytes) is handled like pressure
+  bool over_budget = CurrentUsage() > budget_bytes_;
+  if (!UnderPressure() && !over_budget) {
+    return false;
+  }
+
+  // Cheapest first: drop an idle model entirely
+  if (ModelLoader *victim = PickVictim(nullptr)) {
+    if (victim->Evict()) {
+      ++evictions_;
+      logging::LogInfo("residency",
+                       "Evicted " + victim->GetName() + " under memory pressure");
+      return true;
+    }
+  }
+
+  // Only resident models left: halve the largest context
+  ModelLoader *largest = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &[loader, used] : last_used_) {
+      if (loader->IsLoaded() &&
+          (!largest || loader->GetContextSize() > largest->GetContextSize())) {
+        largest = loader;
+      }
+    }
+  }
+  if (largest && largest->ShrinkContext()) {
+    ++shrinks_;
+    logging::LogInfo("residency",
+                     "Shrank " + largest->GetName() + " context to " +
+                         std::to_string(largest->GetContextSize()) +
+                         " tokens under memory pressure");
+    return true;
+  }
+  return false;
+}
+
+std::string ResidencyManager::FormatStatus() {
+  MemoryPressure pressure = ReadSystemPressure();
+  std::string status = "Budget: " + FormatMiB(CurrentUsage()) + " used of " +
+                       FormatMiB(budget_bytes_);
+  if (pressure.total_bytes > 0) {
+    status += "\nSystem: " + FormatMiB(pressure.available_bytes) +
+              " available of " + FormatMiB(pressure.total_bytes);
+  }
+  if (pressure.psi_some_avg10 >= 0.0f) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f%%", pressure.psi_some_avg10);
+    status += ", memory stall " + std::string(buf);
+  }
+  if (pressure.under_pressure) {
+    status += " (under pressure)";
+  }
+  status += "\nEvictions: " + std::to_string(evictions_) +
+            ", context shrinks: " + std::to_string(shrinks_);
+  return status;
+}
+
+MemoryPressure ResidencyManager::ReadSystemPressure() {
+  MemoryPressure pressure;
+
+  // Values are in kB
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while (std::getline(meminfo, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    uint64_t kb = 0;
+    fields >> key >> kb;
+    if (key == "MemTotal:") {
+      pressure.total_bytes = kb * 1024;
+    } else if (key == "MemAvailable:") {
+      pressure.available_bytes = kb * 1024;
+    }
+  }
+
+  // "some avg10=1.23 avg60=... avg300=... total=..."
+  std::ifstream psi("/proc/pressure/memory");
+  while (std::getline(psi, line)) {
+    if (line.rfind("some ", 0) != 0) {
+      continue;
+    }
+    size_t pos = line.find("avg10=");
+    if (pos != std::string::npos) {
+      pressure.psi_some_avg10 = std::strtof(line.c_str() + pos + 6, nullptr);
+    }
+  }
+
+  if (pressure.total_bytes > 0) {
+    uint64_t floor = std::max<uint64_t>(
+        MIN_AVAILABLE, pressure.total_bytes * MIN_AVAILABLE_FRACTION);
+    pressure.under_pressure = pressure.available_bytes < floor;
+  }
+  if (pressure.psi_some_avg10 >= PSI_SOME_AVG10_LIMIT) {
+    pressure.under_pressure = true;
+  }
+  return pressure;
+}
+
+} // namespace models
+} // namespace zweek
@@ -0,0 +1,65 @@
+#include "models/stop_sequence_matcher.hpp"
+#include <algorithm>
+
+namespace zweek {
+namespace models {
+
+StopSequenceMatcher::StopSequenceMatcher(const std::vector<std::string> &stops) {
+  for (const auto &stop : stops) {
+    if (!stop.empty()) {
+      stops_.push_back(stop);
+    }
+  }
+}
+
+std::string_view StopSequenceMatcher::Feed(std::string_view text) {
+  if (matched_) {
+    return {};
+  }
+  if (stops_.empty()) {
+    return text;
+  }
+  held_ += text;
+
+  // Earliest complete stop sequence wins
+  size_t match = std::string::npos;
+  for (const auto &stop : stops_) {
+    match = std::min(match, held_.find(stop));
+  }
+  if (match != std::string::npos) {
+    matched_ = true;
+    released_.assign(held_, 0, match);
+    held_.clear();
+    return released_;
+  }
+
+  // Hold back the longest tail that is a proper prefix of a stop sequence
+  size_t hold = 0;
+  for (const auto &stop : stops_) {
+    size_t max_len = std::min(held_.size(), stop.size() - 1);
+    for (size_t len = max_len; len > hold; --len) {
+      if (held_.compare(held_.size() - len, len, stop, 0, len) == 0) {
+        hold = len;
+        break;
+      }
+    }
+  }
+
+  released_.assign(held_, 0, held_.size() - hold);
+  held_.erase(0, held_.size() - hold);
+  return released_;
+}
+
+std::string_view StopSequenceMatcher::Flush() {
+  released_.swap(held_);
+  held_.clear();
+  return released_;
+}
+
+void StopSequenceMatcher::Reset() {
+  held_.clear();
+  matched_ = false;
+}
+
+} // namespace models
+} // namespace zweek
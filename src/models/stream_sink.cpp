@@ -0,0 +1,40 @@
+#include "models/stream_sink.hpp"
+
+namespace zweek {
+namespace models {
+
+StreamSink::StreamSink(Callback callback, size_t flush_tokens,
+                       std::chrono::microseconds flush_interval)
+    : callback_(std::move(callback)), flush_tokens_(flush_tokens),
+      flush_interval_(flush_interval) {
+  buffer_.reserve(256);
+  // The first piece is delivered immediately
+  last_flush_ = std::chrono::steady_clock::now() - flush_interval_;
+}
+
+void StreamSink::Write(std::string_view piece) {
+  if (!callback_ || piece.empty()) {
+    return;
+  }
+
+  buffer_.append(piece);
+  ++pending_;
+
+  if (pending_ >= flush_tokens_ ||
+      std::chrono::steady_clock::now() - last_flush_ >= flush_interval_) {
+    Flush();
+  }
+}
+
+void StreamSink::Flush() {
+  if (pending_ == 0) {
+    return;
+  }
+  callback_(buffer_);
+  buffer_.clear();
+  pending_ = 0;
+  last_flush_ = std::chrono::steady_clock::now();
+}
+
+} // namespace models
+} // namespace zweek
@@ -0,0 +1,210 @@
+#include "models/thread_config.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <ggml-cpu.h>
+#include <ggml.h>
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace zweek {
+namespace models {
+
+namespace {
+
+std::vector<int> DetectPhysicalCpus() {
+  std::vector<int> cpus;
+
+#ifdef _WIN32
+  DWORD length = 0;
+  GetLogicalProcessorInformation(nullptr, &length);
+  std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(
+      length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+  if (!info.empty() && GetLogicalProcessorInformation(info.data(), &length)) {
+    for (const auto &entry : info) {
+      if (entry.Relationship != RelationProcessorCore) {
+        continue;
+      }
+      // Lowest logical processor of the core
+      for (int bit = 0; bit < (int)(sizeof(ULONG_PTR) * 8); ++bit) {
+        if (entry.ProcessorMask & ((ULONG_PTR)1 << bit)) {
+          cpus.push_back(bit);
+          break;
+        }
+      }
+    }
+  }
+#else
+  // One logical CPU per (package, core) pair from sysfs topology
+  std::set<std::pair<int, int>> seen;
+  unsigned n_logical = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned cpu = 0; cpu < n_logical; ++cpu) {
+    std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                       "/topology/";
+    std::ifstream core_file(base + "core_id");
+    std::ifstream package_file(base + "physical_package_id");
+    int core = -1, package = -1;
+    if (!(core_file >> core) || !(package_file >> package)) {
+      cpus.clear();
+      break;
+    }
+    if (seen.insert({package, core}).second) {
+      cpus.push_back(cpu);
+    }
+  }
+#endif
+
+  if (cpus.empty()) {
+    unsigned n = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < n; ++i) {
+      cpus.push_back(i);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  return cpus;
+}
+
+std::string CalibrationPath() {
+#ifdef _WIN32
+  const char *home = getenv("USERPROFILE");
+  if (home) {
+    return std::string(home) + "\\.zweek\\cache\\threads.json";
+  }
+#else
+  const char *home = getenv("HOME");
+  if (home) {
+    return std::string(home) + "/.zweek/cache/threads.json";
+  }
+#endif
+  return "";
+}
+
+std::string CalibrationKey(const std::string &model_fingerprint) {
+  return model_fingerprint +
+         "|cores=" + std::to_string(GetPhysicalCpus().size());
+}
+
+json ReadCalibrationFile(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    return json::object();
+  }
+  try {
+    json j = json::parse(file);
+    return j.is_object() ? j : json::object();
+  } catch (const std::exception &) {
+    return json::object();
+  }
+}
+
+} // namespace
+
+const std::vector<int> &GetPhysicalCpus() {
+  static const std::vector<int> cpus = DetectPhysicalCpus();
+  return cpus;
+}
+
+ThreadPools &ThreadPools::Instance() {
+  static ThreadPools instance;
+  return instance;
+}
+
+ThreadPools::~ThreadPools() {
+  for (auto &[key, pool] : pools_) {
+    ggml_threadpool_free(pool);
+  }
+}
+
+ggml_threadpool *ThreadPools::Get(int n_threads, bool pin) {
+  n_threads = std::max(1, std::min(n_threads, GGML_MAX_N_THREADS));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto key = std::make_pair(n_threads, pin);
+  auto it = pools_.find(key);
+  if (it != pools_.end()) {
+    return it->second;
+  }
+
+  ggml_threadpool_params params = ggml_threadpool_params_default(n_threads);
+  if (pin) {
+    // One thread per physical core, skipping SMT siblings
+    const auto &cpus = GetPhysicalCpus();
+    std::fill(std::begin(params.cpumask), std::end(params.cpumask), false);
+    for (int i = 0; i < n_threads; ++i) {
+      int cpu = cpus[i % cpus.size()];
+      if (cpu < GGML_MAX_N_THREADS) {
+        params.cpumask[cpu] = true;
+      }
+    }
+    params.strict_cpu = true;
+  }
+
+  ggml_threadpool *pool = ggml_threadpool_new(&params);
+  if (pool) {
+    pools_[key] = pool;
+  }
+  return pool;
+}
+
+bool LoadCalibratedThreads(const std::string &model_fingerprint,
+                           int &n_threads_decode, int &n_threads_prefill) {
+  std::string path = CalibrationPath();
+  if (path.empty() || model_fingerprint.empty()) {
+    return false;
+  }
+
+  json j = ReadCalibrationFile(path);
+  auto it = j.find(CalibrationKey(model_fingerprint));
+  if (it == j.end()) {
+    return false;
+  }
+  try {
+    n_threads_decode = it->at("decode").get<int>();
+    n_threads_prefill = it->at("prefill").get<int>();
+  } catch (const std::exception &) {
+    return false;
+  }
+  return n_threads_decode > 0 && n_threads_prefill > 0;
+}
+
+void SaveCalibratedThreads(const std::string &model_fingerprint,
+                           int n_threads_decode, int n_threads_prefill) {
+  std::string path = CalibrationPath();
+  if (path.empty() || model_fingerprint.empty()) {
+    return;
+  }
+
+  json j = ReadCalibrationFile(path);
+  j[CalibrationKey(model_fingerprint)] = {{"decode", n_threads_decode},
+                                          {"prefill", n_threads_prefill}};
+
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), ec);
+
+  // Write then rename so a crash never leaves a truncated file
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    if (!file) {
+      return;
+    }
+    file << j.dump(2);
+  }
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+  }
+}
+
+} // namespace models
+} // namespace zweek
@@ -0,0 +1,206 @@
+#include "pipeline/inference_service.hpp"
+#include <algorithm>
+
+namespace zweek {
+namespace pipeline {
+
+// --- TokenChannel ---
+
+void TokenChannel::Push(const std::string &chunk) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+      return;
+    }
+    chunks_.push_back(chunk);
+  }
+  cv_.notify_one();
+}
+
+bool TokenChannel::Pop(std::string &chunk) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return closed_ || !chunks_.empty(); });
+  if (chunks_.empty()) {
+    return false;
+  }
+  chunk = std::move(chunks_.front());
+  chunks_.pop_front();
+  return true;
+}
+
+bool TokenChannel::TryPop(std::string &chunk) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (chunks_.empty()) {
+    return false;
+  }
+  chunk = std::move(chunks_.front());
+  chunks_.pop_front();
+  return true;
+}
+
+void TokenChannel::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+  }
+  cv_.notify_all();
+}
+
+bool TokenChannel::IsClosed() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return closed_;
+}
+
+// --- InferenceHandle ---
+
+void InferenceHandle::Cancel() {
+  if (cancelled_) {
+    cancelled_->store(true);
+    cancel_->store(true);
+  }
+}
+
+// --- InferenceService ---
+
+InferenceService::InferenceService(size_t max_queued)
+    : max_queued_(max_queued) {
+  worker_ = std::thread(&InferenceService::WorkerLoop, this);
+}
+
+InferenceService::~InferenceService() { Shutdown(); }
+
+InferenceHandle InferenceService::Submit(InferenceJob job, Priority priority) {
+  Task task;
+  task.job = std::move(job);
+  task.priority = priority;
+  task.cancel = std::make_shared<std::atomic<bool>>(false);
+  task.cancelled = std::make_shared<std::atomic<bool>>(false);
+  task.tokens = std::make_shared<TokenChannel>();
+  task.promise = std::make_shared<std::promise<std::string>>();
+
+  InferenceHandle handle;
+  handle.result_ = task.promise->get_future().share();
+  handle.tokens_ = task.tokens;
+  handle.cancel_ = task.cancel;
+  handle.cancelled_ = task.cancelled;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      Finish(task, "[Error: Inference service stopped]");
+      return handle;
+    }
+    if (queue_.size() >= max_queued_) {
+      Finish(task, "[Error: Inference queue full]");
+      return handle;
+    }
+
+    task.sequence = next_sequence_++;
+
+    // Preempt lower-priority work; the worker requeues it when it returns
+    if (running_ && priority > running_->priority && !running_->preempted) {
+      running_->preempted = true;
+      running_->cancel->store(true);
+    }
+
+    queue_.push_back(std::move(task));
+  }
+  cv_.notify_one();
+  return handle;
+}
+
+size_t InferenceService::QueuedCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+bool InferenceService::IsBusy() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_ != nullptr;
+}
+
+void InferenceService::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      return;
+    }
+    stopping_ = true;
+    if (running_) {
+      running_->cancelled->store(true);
+      running_->cancel->store(true);
+    }
+    for (auto &task : queue_) {
+      Finish(task, "[cancelled]");
+    }
+    queue_.clear();
+  }
+  cv_.notify_all();
+
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void InferenceService::Finish(Task &task, const std::string &result) {
+  task.tokens->Close();
+  task.promise->set_value(result);
+}
+
+void InferenceService::WorkerLoop() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (stopping_) {
+        return;
+      }
+
+      // Highest priority first, then oldest
+      auto next = std::min_element(
+          queue_.begin(), queue_.end(), [](const Task &a, const Task &b) {
+            if (a.priority != b.priority) {
+              return a.priority > b.priority;
+            }
+            return a.sequence < b.sequence;
+          });
+      task = std::move(*next);
+      queue_.erase(next);
+      running_ = &task;
+    }
+
+    std::string result;
+    if (task.cancelled->load()) {
+      result = "[cancelled]";
+    } else {
+      JobContext context;
+      context.cancel = task.cancel.get();
+      context.tokens = task.tokens.get();
+      try {
+        result = task.job(context);
+      } catch (const std::exception &e) {
+        result = std::string("[Error: ") + e.what() + "]";
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = nullptr;
+
+      // Preempted (not cancelled): run again once higher-priority work is
+      // done, keeping its place among jobs of the same priority
+      if (task.preempted && !task.cancelled->load() && !stopping_) {
+        task.preempted = false;
+        task.cancel->store(false);
+        queue_.push_back(std::move(task));
+        continue;
+      }
+    }
+
+    Finish(task, result);
+  }
+}
+
+} // namespace pipeline
+} // namespace zweek
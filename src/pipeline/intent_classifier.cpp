@@ -0,0 +1,290 @@
+#include "pipeline/intent_classifier.hpp"
+#include "pipeline/route_cache.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <nlohmann/json.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ZWEEK_HAVE_SSE2 1
+#endif
+
+using json = nlohmann::json;
+
+namespace zweek {
+namespace pipeline {
+
+namespace {
+
+constexpr char FILE_MAGIC[4] = {'Z', 'W', 'I', 'C'};
+constexpr uint32_t FILE_VERSION = 1;
+
+// Dot product of two n-float arrays
+float Dot(const float *a, const float *b, int n) {
+  int i = 0;
+  float sum = 0.0f;
+#ifdef ZWEEK_HAVE_SSE2
+  __m128 acc = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, acc);
+  sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+  for (; i < n; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+void Softmax(std::vector<float> &scores) {
+  float max_score = *std::max_element(scores.begin(), scores.end());
+  float sum = 0.0f;
+  for (float &s : scores) {
+    s = std::exp(s - max_score);
+    sum += s;
+  }
+  for (float &s : scores) {
+    s /= sum;
+  }
+}
+
+} // namespace
+
+IntentClassifier::IntentClassifier()
+    : weights_(Labels().size() * HASH_DIM, 0.0f),
+      bias_(Labels().size(), 0.0f) {}
+
+const std::vector<std::string> &IntentClassifier::Labels() {
+  static const std::vector<std::string> labels = {"code", "chat", "tool"};
+  return labels;
+}
+
+int IntentClassifier::LabelIndex(const std::string &label) {
+  const auto &labels = Labels();
+  auto it = std::find(labels.begin(), labels.end(), label);
+  return it == labels.end() ? -1 : (int)(it - labels.begin());
+}
+
+int IntentClassifier::FindLabel(const std::string &text) {
+  std::string lower = text;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  const auto &labels = Labels();
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (lower.find(labels[i]) != std::string::npos) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+std::vector<std::pair<uint32_t, float>>
+IntentClassifier::Features(const std::string &input) {
+  // Same normalization as the route cache, padded to mark word edges
+  std::string text = " " + RouteCache::Normalize(input) + " ";
+
+  std::vector<float> counts(HASH_DIM, 0.0f);
+  std::vector<uint32_t> touched;
+  for (size_t n = 2; n <= 4; ++n) {
+    for (size_t i = 0; i + n <= text.size(); ++i) {
+      // FNV-1a of the n-gram, seeded by n so 2- and 3-grams differ
+      uint32_t hash = 2166136261u ^ (uint32_t)n;
+      for (size_t k = 0; k < n; ++k) {
+        hash ^= (unsigned char)text[i + k];
+        hash *= 16777619u;
+      }
+      uint32_t index = hash & (HASH_DIM - 1);
+      if (counts[index] == 0.0f) {
+        touched.push_back(index);
+      }
+      counts[index] += 1.0f;
+    }
+  }
+
+  std::vector<std::pair<uint32_t, float>> features;
+  for (uint32_t index : touched) {
+    features.emplace_back(index, counts[index]);
+  }
+
+  float norm = 0.0f;
+  for (const auto &f : features) {
+    norm += f.second * f.second;
+  }
+  norm = std::sqrt(norm);
+  if (norm > 0.0f) {
+    for (auto &f : features) {
+      f.second /= norm;
+    }
+  }
+  return features;
+}
+
+std::vector<float>
+IntentClassifier::Scores(const std::vector<float> &dense) const {
+  std::vector<float> scores(bias_);
+  for (size_t c = 0; c < scores.size(); ++c) {
+    scores[c] += Dot(weights_.data() + c * HASH_DIM, dense.data(), HASH_DIM);
+  }
+  return scores;
+}
+
+std::vector<float> IntentClassifier::Predict(const std::string &input) const {
+  std::vector<float> dense(HASH_DIM, 0.0f);
+  for (const auto &[index, value] : Features(input)) {
+    dense[index] = value;
+  }
+  std::vector<float> scores = Scores(dense);
+  Softmax(scores);
+  return scores;
+}
+
+void IntentClassifier::Train(const std::vector<IntentExample> &examples,
+                             int epochs, float learning_rate) {
+  const size_t n_labels = Labels().size();
+  std::fill(weights_.begin(), weights_.end(), 0.0f);
+  std::fill(bias_.begin(), bias_.end(), 0.0f);
+
+  // Featurize once
+  std::vector<std::vector<std::pair<uint32_t, float>>> features;
+  for (const auto &ex : examples) {
+    features.push_back(Features(ex.input));
+  }
+
+  std::vector<size_t> order(examples.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937 rng(42); // Fixed seed: same log, same weights
+
+  for (int epoch = 0; epoch < epochs; ++epoch) {
+    std::shuffle(order.begin(), order.end(), rng);
+    float lr = learning_rate / (1.0f + epoch * 0.1f);
+
+    for (size_t i : order) {
+      const auto &x = features[i];
+
+      // Scores from the sparse features
+      std::vector<float> probs(bias_);
+      for (size_t c = 0; c < n_labels; ++c) {
+        for (const auto &[index, value] : x) {
+          probs[c] += weights_[c * HASH_DIM + index] * value;
+        }
+      }
+      Softmax(probs);
+
+      // Cross-entropy gradient
+      for (size_t c = 0; c < n_labels; ++c) {
+        float grad = probs[c] - (c == (size_t)examples[i].label ? 1.0f : 0.0f);
+        bias_[c] -= lr * grad;
+        for (const auto &[index, value] : x) {
+          weights_[c * HASH_DIM + index] -= lr * grad * value;
+        }
+      }
+    }
+  }
+  trained_ = !examples.empty();
+}
+
+float IntentClassifier::Evaluate(
+    const std::vector<IntentExample> &examples) const {
+  if (examples.empty()) {
+    return 0.0f;
+  }
+  size_t correct = 0;
+  for (const auto &ex : examples) {
+    std::vector<float> probs = Predict(ex.input);
+    int best = std::max_element(probs.begin(), probs.end()) - probs.begin();
+    if (best == ex.label) {
+      ++correct;
+    }
+  }
+  return (float)correct / examples.size();
+}
+
+bool IntentClassifier::Load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version = 0, dim = 0, n_labels = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&dim), sizeof(dim));
+  file.read(reinterpret_cast<char *>(&n_labels), sizeof(n_labels));
+  if (!file || std::memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+      version != FILE_VERSION || dim != (uint32_t)HASH_DIM ||
+      n_labels != Labels().size()) {
+    return false;
+  }
+
+  std::vector<float> weights(weights_.size());
+  std::vector<float> bias(bias_.size());
+  file.read(reinterpret_cast<char *>(weights.data()),
+            weights.size() * sizeof(float));
+  file.read(reinterpret_cast<char *>(bias.data()), bias.size() * sizeof(float));
+  if (!file) {
+    return false;
+  }
+
+  weights_ = std::move(weights);
+  bias_ = std::move(bias);
+  trained_ = true;
+  return true;
+}
+
+bool IntentClassifier::Save(const std::string &path) const {
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  uint32_t dim = HASH_DIM;
+  uint32_t n_labels = Labels().size();
+  file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+  file.write(reinterpret_cast<const char *>(&FILE_VERSION),
+             sizeof(FILE_VERSION));
+  file.write(reinterpret_cast<const char *>(&dim), sizeof(dim));
+  file.write(reinterpret_cast<const char *>(&n_labels), sizeof(n_labels));
+  file.write(reinterpret_cast<const char *>(weights_.data()),
+             weights_.size() * sizeof(float));
+  file.write(reinterpret_cast<const char *>(bias_.data()),
+             bias_.size() * sizeof(float));
+  return (bool)file;
+}
+
+std::vector<IntentExample>
+IntentClassifier::ReadDecisionLog(const std::string &path,
+                                  float min_confidence) {
+  std::vector<IntentExample> examples;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    try {
+      json j = json::parse(line);
+      if (j.value("confidence", 1.0f) < min_confidence) {
+        continue;
+      }
+      int label = LabelIndex(j.at("intent").get<std::string>());
+      if (label < 0) {
+        continue;
+      }
+      examples.push_back({j.at("input").get<std::string>(), label});
+    } catch (const std::exception &) {
+      // Skip malformed lines
+    }
+  }
+  return examples;
+}
+
+} // namespace pipeline
+} // namespace zweek
@@ -4,12 +4,39 @@
 namespace zweek {
 namespace pipeline {
 
+namespace {
+
+std::string IntentName(Intent intent) {
+  switch (intent) {
+  case Intent::CodeGeneration:
+    return "code";
+  case Intent::Chat:
+    return "chat";
+  case Intent::Tool:
+    return "tool";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace
+
 Orchestrator::Orchestrator() : command_handler_() {
+  // Agent settings: AgentConfig defaults, overridden by ~/.zweek/config.json
+  coder::LoadAgentConfigFile(coder::GetDefaultConfigPath(), agent_config_);
+
   // Initialize history manager
   history_manager_.Init("");
   
   // Wire history manager to chat mode
   chat_mode_.SetHistoryManager(&history_manager_);
+
+  // Forward prompt prefill progress from chat mode
+  chat_mode_.SetPrefillProgressCallback([this](int done, int total) {
+    if (prefill_progress_callback_) {
+      prefill_progress_callback_(done, total);
+    }
+  });
   
   // Wire history manager to command handler
   command_handler_.SetHistoryManager(&history_manager_);
@@ -18,6 +45,10 @@ Orchestrator::Orchestrator() : command_handler_() {
   // Wire tool executor to command handler
   command_handler_.SetToolExecutor(&tool_executor_);
   
+  // Wire routing stats for /routes
+  command_handler_.SetRoutingStatsProvider(
+      [this]() { return FormatRoutingStats(); });
+
   // Wire directory change callback
   command_handler_.SetDirectoryChangeCallback([this](const std::string& path) {
     if (directory_update_callback_) {
@@ -52,8 +83,38 @@ void Orchestrator::ProcessRequest(const std::string &user_request) {
   }
 
   // Step 1: Classify intent
-  Intent intent = router_.ClassifyIntent(user_request);
-  WorkflowType workflow = router_.GetWorkflow(intent);
+  RouteResult route = router_.Route(user_request);
+  WorkflowType workflow = router_.GetWorkflow(route.intent);
+
+  // Don't start the code pipeline or tools on a guess; chat can answer
+  // anything and ask for clarification
+  if (route.low_confidence) {
+    workflow = WorkflowType::ChatMode;
+  }
+
+  if (progress_callback_) {
+    std::string percent = std::to_string((int)(route.confidence * 100)) + "%";
+    std::string detail;
+    switch (route.source) {
+    case RouteSource::Rule:
+      detail = "rule";
+      break;
+    case RouteSource::Cache:
+      detail = "cached";
+      break;
+    case RouteSource::Classifier:
+      detail = "classifier, " + percent;
+      break;
+    case RouteSource::Model:
+      detail = percent + " confidence";
+      break;
+    case RouteSource::Grammar:
+      detail = "grammar";
+      break;
+    }
+    progress_callback_("Intent: " + IntentName(route.intent) + " (" + detail +
+                       (route.low_confidence ? ", using chat" : "") + ")");
+  }
 
   // Step 2: Execute appropriate workflow
   switch (workflow) {
@@ -80,6 +141,25 @@ void Orchestrator::ProcessRequest(const std::string &user_request) {
   }
 }
 
+std::string Orchestrator::FormatRoutingStats() const {
+  RouterStats stats = router_.GetStats();
+  int total = stats.rule_hits + stats.cache_hits + stats.classifier_hits +
+              stats.model_calls;
+  if (total == 0) {
+    return "No requests routed yet.";
+  }
+
+  auto line = [total](const std::string &name, int count) {
+    return "  " + name + std::to_string(count) + " (" +
+           std::to_string(count * 100 / total) + "%)\n";
+  };
+  return "Routing (" + std::to_string(total) + " requests):\n" +
+         line("Rules:        ", stats.rule_hits) +
+         line("Cache hits:   ", stats.cache_hits) +
+         line("Classifier:   ", stats.classifier_hits) +
+         line("Router model: ", stats.model_calls);
+}
+
 void Orchestrator::SetProgressCallback(
     std::function<void(const std::string &)> callback) {
   progress_callback_ = callback;
@@ -100,6 +180,23 @@ void Orchestrator::SetDirectoryUpdateCallback(
   directory_update_callback_ = callback;
 }
 
+void Orchestrator::SetPrefillProgressCallback(
+    std::function<void(int, int)> callback) {
+  prefill_progress_callback_ = callback;
+}
+
+void Orchestrator::SetInferenceStatsCallback(
+    std::function<void(const models::InferenceStats &)> callback) {
+  inference_stats_callback_ = callback;
+}
+
+void Orchestrator::ReportStats(const models::InferenceStats &stats) {
+  last_stats_ = stats;
+  if (inference_stats_callback_) {
+    inference_stats_callback_(stats);
+  }
+}
+
 void Orchestrator::SetAgentThoughtCallback(
     std::function<void(const std::string &)> callback) {
   agent_thought_callback_ = callback;
@@ -118,12 +215,6 @@ void Orchestrator::SetAgentResultCallback(
 void Orchestrator::RunCodePipeline(const std::string &request) {
   // Lazy-initialize the recursive agent
   if (!agent_) {
-    agent_config_.model_path = "models/Qwen3-0.6B-Q8_0.gguf";
-    agent_config_.max_steps = 25;
-    agent_config_.max_tokens_per_step = 512;
-    agent_config_.context_window = 2048;
-    agent_config_.history_window = 8;
-
     agent_ = std::make_unique<coder::RecursiveAgent>(agent_config_);
 
     if (progress_callback_) {
@@ -184,6 +275,16 @@ void Orchestrator::RunCodePipeline(const std::string &request) {
     }
   };
 
+  callbacks.on_prefill_progress = [this](int done, int total) {
+    if (prefill_progress_callback_) {
+      prefill_progress_callback_(done, total);
+    }
+  };
+
+  callbacks.on_inference_stats = [this](const models::InferenceStats &stats) {
+    ReportStats(stats);
+  };
+
   callbacks.on_finish = [this](const std::string& summary) {
     if (progress_callback_) {
       progress_callback_("Task complete");
@@ -201,6 +302,9 @@ void Orchestrator::RunCodePipeline(const std::string &request) {
   // Start and run the task
   agent_->StartTask(request, tool_executor_.GetWorkingDirectory());
 
+  // One model call plans the lookups, which then run in parallel
+  agent_->PlanTask(interrupt_flag_);
+
   std::string result = agent_->Run(interrupt_flag_);
 
   // Store in history
@@ -226,6 +330,8 @@ void Orchestrator::RunChatMode(const std::string &request) {
     }
   }, interrupt_flag_);
 
+  ReportStats(chat_mode_.GetLastStats());
+
   // Mark as complete after streaming finishes
   if (response_callback_) {
     response_callback_(response);
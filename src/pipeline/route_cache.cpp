@@ -0,0 +1,155 @@
+#include "pipeline/route_cache.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace zweek {
+namespace pipeline {
+
+RouteCache::RouteCache(const std::string &path, size_t capacity)
+    : path_(path), capacity_(capacity) {
+  Load();
+}
+
+std::string RouteCache::Normalize(const std::string &input) {
+  std::string out;
+  bool pending_space = false;
+  for (unsigned char c : input) {
+    if (std::isspace(c)) {
+      pending_space = !out.empty();
+      continue;
+    }
+    if (pending_space) {
+      out += ' ';
+      pending_space = false;
+    }
+    out += std::tolower(c);
+  }
+
+  // "list files?" and "list files" are the same request
+  while (!out.empty() && (out.back() == '?' || out.back() == '!' ||
+                          out.back() == '.')) {
+    out.pop_back();
+  }
+  return out;
+}
+
+bool RouteCache::Lookup(const std::string &input, std::string &label) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(Normalize(input));
+  if (it == index_.end()) {
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  label = it->second->second;
+  return true;
+}
+
+void RouteCache::Insert(const std::string &input, const std::string &label) {
+  std::string key = Normalize(input);
+  if (key.empty()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->second = label;
+    entries_.splice(entries_.begin(), entries_, it->second);
+  } else {
+    entries_.emplace_front(key, label);
+    index_[key] = entries_.begin();
+    while (entries_.size() > capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+  Save();
+}
+
+size_t RouteCache::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::string RouteCache::GetDefaultPath() {
+#ifdef _WIN32
+  const char *home = getenv("USERPROFILE");
+  if (home) {
+    return std::string(home) + "\\.zweek\\cache\\routes.json";
+  }
+#else
+  const char *home = getenv("HOME");
+  if (home) {
+    return std::string(home) + "/.zweek/cache/routes.json";
+  }
+#endif
+  return ""; // No home directory: memory only
+}
+
+void RouteCache::Load() {
+  if (path_.empty()) {
+    return;
+  }
+
+  std::ifstream file(path_);
+  if (!file) {
+    return;
+  }
+
+  try {
+    json j = json::parse(file);
+    // Stored most recently used first
+    for (const auto &entry : j) {
+      if (entries_.size() >= capacity_) {
+        break;
+      }
+      std::string key = entry.at("input").get<std::string>();
+      if (index_.count(key)) {
+        continue;
+      }
+      entries_.emplace_back(key, entry.at("intent").get<std::string>());
+      index_[key] = std::prev(entries_.end());
+    }
+  } catch (const std::exception &) {
+    // Corrupt cache: start empty
+    entries_.clear();
+    index_.clear();
+  }
+}
+
+void RouteCache::Save() {
+  if (path_.empty()) {
+    return;
+  }
+
+  json j = json::array();
+  for (const auto &[key, label] : entries_) {
+    j.push_back({{"input", key}, {"intent", label}});
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(path_).parent_path(), ec);
+
+  // Write then rename so a crash never leaves a truncated cache
+  std::string tmp_path = path_ + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    if (!file) {
+      return;
+    }
+    file << j.dump();
+  }
+  std::filesystem::rename(tmp_path, path_, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+  }
+}
+
+} // namespace pipeline
+} // namespace zweek
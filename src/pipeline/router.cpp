@@ -1,46 +1,192 @@
 #include "pipeline/router.hpp"
 #include "pipeline/grammars.hpp"
 #include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
 
 namespace zweek {
 namespace pipeline {
 
+namespace {
+
+std::string IntentLabel(Intent intent) {
+  switch (intent) {
+  case Intent::CodeGeneration:
+    return "code";
+  case Intent::Tool:
+    return "tool";
+  default:
+    return "chat";
+  }
+}
+
+Intent IntentFromLabel(const std::string &label) {
+  if (label == "code") {
+    return Intent::CodeGeneration;
+  }
+  if (label == "tool") {
+    return Intent::Tool;
+  }
+  return Intent::Chat;
+}
+
+// Distilled classifier weights, trained with zweek_train_router
+constexpr const char *CLASSIFIER_PATH = "models/intent-classifier.bin";
+
+} // namespace
+
 Router::Router() {
-  // Constructor
+  model_loader_.SetName("router");
+
+  // Optional: without weights every uncached request goes to the model
+  classifier_.Load(CLASSIFIER_PATH);
 }
 
 Router::~Router() { UnloadModel(); }
 
 Intent Router::ClassifyIntent(const std::string &user_input) {
+  return Route(user_input).intent;
+}
+
+bool Router::MatchRules(const std::string &normalized, Intent &intent) {
+  // Requests that are plainly searches or listings. A bare "find ..." is
+  // left to the later tiers: "find and fix the crash" is a code request.
+  static const char *TOOL_PREFIXES[] = {
+      "grep ", "ls ", "list files", "list the files", "find files",
+      "find all ", "find every ", "find where ", "find usages",
+      "find references", "search for ", "search the codebase"};
+
+  if (normalized == "ls") {
+    intent = Intent::Tool;
+    return true;
+  }
+  for (const char *prefix : TOOL_PREFIXES) {
+    if (normalized.rfind(prefix, 0) == 0) {
+      intent = Intent::Tool;
+      return true;
+    }
+  }
+  return false;
+}
+
+RouteResult Router::Route(const std::string &user_input) {
+  RouteResult route;
+  route.confidence = 1.0f;
+  route.low_confidence = false;
+
+  // Tier 1: deterministic rules
+  if (MatchRules(RouteCache::Normalize(user_input), route.intent)) {
+    route.source = RouteSource::Rule;
+    ++stats_.rule_hits;
+    return route;
+  }
+
+  // Tier 2: previous decisions
+  std::string label;
+  if (route_cache_.Lookup(user_input, label)) {
+    route.intent = IntentFromLabel(label);
+    route.source = RouteSource::Cache;
+    ++stats_.cache_hits;
+    return route;
+  }
+
+  // Tier 3: the distilled classifier
+  if (classifier_.IsTrained()) {
+    std::vector<float> probs = classifier_.Predict(user_input);
+    size_t best = std::max_element(probs.begin(), probs.end()) - probs.begin();
+    if (probs[best] >= classifier_threshold_) {
+      route.intent = IntentFromLabel(IntentClassifier::Labels()[best]);
+      route.confidence = probs[best];
+      route.source = RouteSource::Classifier;
+      ++stats_.classifier_hits;
+      return route;
+    }
+  }
+
+  // Tier 4: the router model
+  ++stats_.model_calls;
+  route.source = RouteSource::Model;
+  route.confidence = 0.0f;
+  route.low_confidence = true;
+
   // Load model if not loaded (resident)
   if (!model_loaded_) {
     LoadModel("models/smollm-135m-router.gguf");
   }
 
-  // Use GBNF grammar for guaranteed valid output
   std::string prompt = "Classify this request as CODE, CHAT, or TOOL:\n" +
                        user_input + "\nClassification:";
 
+  // Score the three labels from a single decode
+  static const std::vector<std::string> labels = {" CODE", " CHAT", " TOOL"};
+  static const Intent intents[] = {Intent::CodeGeneration, Intent::Chat,
+                                   Intent::Tool};
+
+  std::vector<float> probs = model_loader_.ScoreLabels(prompt, labels);
+  if (probs.size() == labels.size()) {
+    size_t best = std::max_element(probs.begin(), probs.end()) - probs.begin();
+    route.intent = intents[best];
+    route.confidence = probs[best];
+    route.low_confidence = route.confidence < confidence_threshold_;
+    LogDecision(user_input, route);
+    if (!route.low_confidence) {
+      route_cache_.Insert(user_input, IntentLabel(route.intent));
+    }
+    return route;
+  }
+
+  // Labels share a first token in this vocab: use GBNF grammar for
+  // guaranteed valid output
   std::string result =
       model_loader_.Infer(prompt, grammars::ROUTER_GRAMMAR, 10,
                           [](const std::string &) {});
 
-  // Parse result
-  std::string lower = result;
-  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  // The grammar only admits a label, so a parsed one is a real decision
+  // even without a probability. Default to chat, flagged, if parsing fails.
+  int parsed = IntentClassifier::FindLabel(result);
+  if (parsed >= 0) {
+    route.intent = IntentFromLabel(IntentClassifier::Labels()[parsed]);
+    route.source = RouteSource::Grammar;
+    route.low_confidence = false;
+  }
+  return route;
+}
 
-  if (lower.find("code") != std::string::npos) {
-    return Intent::CodeGeneration;
+std::string Router::GetDecisionLogPath() {
+#ifdef _WIN32
+  const char *home = getenv("USERPROFILE");
+  if (home) {
+    return std::string(home) + "\\.zweek\\logs\\router-decisions.jsonl";
   }
-  if (lower.find("chat") != std::string::npos) {
-    return Intent::Chat;
+#else
+  const char *home = getenv("HOME");
+  if (home) {
+    return std::string(home) + "/.zweek/logs/router-decisions.jsonl";
   }
-  if (lower.find("tool") != std::string::npos) {
-    return Intent::Tool;
+#endif
+  return ""; // No home directory: logging disabled
+}
+
+void Router::LogDecision(const std::string &user_input,
+                         const RouteResult &route) {
+  std::string path = GetDecisionLogPath();
+  if (path.empty()) {
+    return;
   }
 
-  // Default to chat if parsing fails
-  return Intent::Chat;
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), ec);
+
+  nlohmann::json entry = {{"input", user_input},
+                          {"intent", IntentLabel(route.intent)},
+                          {"confidence", route.confidence}};
+  std::ofstream file(path, std::ios::app);
+  if (file) {
+    file << entry.dump() << "\n";
+  }
 }
 
 WorkflowType Router::GetWorkflow(Intent intent) {
@@ -3,6 +3,7 @@
 #include "commands/command_handler.hpp"
 #include <ftxui/component/component_options.hpp>
 #include <ftxui/dom/elements.hpp>
+#include <cstdio>
 #include <sstream>
 
 using namespace ftxui;
@@ -233,6 +234,21 @@ void TUI::SetCurrentDirectory(const std::string &path) {
   screen_.PostEvent(Event::Custom);
 }
 
+void TUI::SetPrefillProgress(int done, int total) {
+  state_.prefill_done = done;
+  state_.prefill_total = total;
+  screen_.PostEvent(Event::Custom);
+}
+
+void TUI::SetInferenceSpeed(double decode_tps, double prefill_tps,
+                            double ttft_ms) {
+  char buf[96];
+  std::snprintf(buf, sizeof(buf), "%.1f tok/s | prefill %.0f tok/s | TTFT %.0f ms",
+                decode_tps, prefill_tps, ttft_ms);
+  state_.perf_status = buf;
+  screen_.PostEvent(Event::Custom);
+}
+
 void TUI::SetOnSubmit(std::function<void(const std::string &)> callback) {
   on_submit_ = callback;
 }
@@ -243,6 +259,10 @@ void TUI::SetOnReject(std::function<void()> callback) { on_reject_ = callback; }
 
 void TUI::SetOnModify(std::function<void()> callback) { on_modify_ = callback; }
 
+void TUI::SetOnInterrupt(std::function<void()> callback) {
+  on_interrupt_ = callback;
+}
+
 void TUI::SetOnModeSwitch(std::function<void(Mode)> callback) {
   on_mode_switch_ = callback;
 }
@@ -326,13 +346,14 @@ Component TUI::CreateTerminalView() {
       } else if (msg.find("[THINKING] ") == 0) {
         // Thinking content
         if (state_.show_thinking) {
-            e = text(msg.substr(11)) | color(Color::GrayLight) | dim;
+            e = paragraph(msg.substr(11)) | color(Color::GrayLight) | dim;
         } else {
             // Skip rendering if hidden
             continue; 
         }
       } else {
-        e = text(msg);
+        // Model output arrives unwrapped; wrap it to the terminal width
+        e = paragraph(msg);
       }
 
       // Apply focus to the element at the current scroll position
@@ -357,7 +378,7 @@ Component TUI::CreateTerminalView() {
           std::istringstream thinking_stream(state_.current_thinking);
           std::string thinking_line;
           while (std::getline(thinking_stream, thinking_line)) {
-            Element line = text(thinking_line) | color(Color::GrayLight) | dim;
+            Element line = paragraph(thinking_line) | color(Color::GrayLight) | dim;
             if (history_elements.size() == render_pos) line = line | focus;
             history_elements.push_back(line);
           }
@@ -379,7 +400,7 @@ Component TUI::CreateTerminalView() {
         std::istringstream answer_stream(state_.current_answer);
         std::string answer_line;
         while (std::getline(answer_stream, answer_line)) {
-          Element line = text(answer_line);
+          Element line = paragraph(answer_line);
           if (history_elements.size() == render_pos) line = line | focus;
           history_elements.push_back(line);
         }
@@ -398,6 +419,17 @@ Component TUI::CreateTerminalView() {
         text("Working... ") | color(Color::Yellow),
         text(spinner) | color(Color::Yellow) | bold
       });
+
+      // Prefill progress bar while a long prompt is being decoded
+      if (state_.prefill_total > 0 && state_.prefill_done < state_.prefill_total) {
+        float fraction = static_cast<float>(state_.prefill_done) / state_.prefill_total;
+        status_bar = hbox({
+          status_bar,
+          text("  Reading prompt ") | color(Color::GrayLight) | dim,
+          gauge(fraction) | color(Color::Cyan) | size(WIDTH, EQUAL, 20),
+          text(" " + std::to_string(static_cast<int>(fraction * 100)) + "%") | color(Color::GrayLight) | dim
+        });
+      }
       
       if (history_elements.size() == render_pos) {
           status_bar = status_bar | focus;
@@ -521,9 +553,14 @@ Component TUI::CreateModeSelector() {
       help_text = "y: Accept | n: Reject | Ctrl+C: Exit";
     }
 
-    return hbox({text(mode_text) | color(Color::Cyan), separator(),
-                 text(" " + state_.current_directory + " ") | color(Color::Yellow), separator(),
-                 text(help_text) | dim});
+    Elements status = {text(mode_text) | color(Color::Cyan), separator(),
+                       text(" " + state_.current_directory + " ") | color(Color::Yellow), separator()};
+    if (!state_.perf_status.empty()) {
+      status.push_back(text(" " + state_.perf_status + " ") | color(Color::GrayLight));
+      status.push_back(separator());
+    }
+    status.push_back(text(help_text) | dim);
+    return hbox(status);
   });
 }
 
@@ -579,6 +616,9 @@ Component TUI::CreateInputLine() {
         return true;
       }
       state_.interrupt_inference_.store(true);
+      if (on_interrupt_) {
+        on_interrupt_();
+      }
       state_.conversation_history.push_back("[Interrupting...]");
       return true;
     }
@@ -289,6 +289,73 @@ void test_execute_command() {
     std::cout << "  PASSED" << std::endl;
 }
 
+void test_execute_batch() {
+    std::cout << "Testing ExecuteBatch..." << std::endl;
+
+    auto test_dir = create_test_dir();
+    write_test_file(test_dir / "a.txt", "alpha\nbeta\ngamma\n");
+    write_test_file(test_dir / "b.txt", "one\ntwo\n");
+
+    zweek::coder::AgentToolSet toolset(test_dir.string());
+
+    // Reads run together; results come back in command order
+    auto results = toolset.ExecuteBatch({"READ_LINES a.txt 1-3\n",
+                                         "READ_LINES b.txt 1-2\n",
+                                         "FILE_INFO a.txt\n"});
+    assert(results.size() == 3);
+    assert(results[0].success && results[0].output.find("alpha") != std::string::npos);
+    assert(results[1].success && results[1].output.find("two") != std::string::npos);
+    assert(results[2].success && results[2].output.find("exists: true") != std::string::npos);
+
+    // A write is a barrier: the read after it sees the change
+    results = toolset.ExecuteBatch({"READ_LINES a.txt 1-1",
+                                    "DELETE_LINES a.txt 1-1",
+                                    "READ_LINES a.txt 1-1"});
+    assert(results[0].output.find("alpha") != std::string::npos);
+    assert(results[1].success);
+    assert(results[2].output.find("beta") != std::string::npos);
+
+    // Nothing runs after FINISH, and batches are bounded
+    results = toolset.ExecuteBatch({"FINISH done", "DELETE_LINES a.txt 1-1"});
+    assert(results[0].finished);
+    assert(!results[1].success);
+    assert(read_test_file(test_dir / "a.txt") == "beta\ngamma\n");
+
+    std::vector<std::string> many(zweek::coder::AgentToolSet::MAX_BATCH_COMMANDS + 1,
+                                  "LIST .");
+    results = toolset.ExecuteBatch(many);
+    assert(results.front().success);
+    assert(!results.back().success);
+    assert(results.back().error.find("Too many commands") != std::string::npos);
+
+    // Merged into one observation, each under its command
+    std::vector<std::string> commands = {"READ_LINES b.txt 1-1\n", "GREP zzz b.txt\n"};
+    auto merged = zweek::coder::AgentToolSet::MergeResults(
+        commands, toolset.ExecuteBatch(commands));
+    assert(merged.output.find("[READ_LINES b.txt 1-1]\n1: one\n") == 0);
+    assert(merged.output.find("[GREP zzz b.txt]\n") != std::string::npos);
+
+    fs::remove_all(test_dir);
+    std::cout << "  PASSED" << std::endl;
+}
+
+void test_is_read_only() {
+    std::cout << "Testing read-only command detection..." << std::endl;
+
+    using zweek::coder::AgentToolSet;
+    assert(AgentToolSet::IsReadOnly("READ_LINES src/main.cpp 1-10\n"));
+    assert(AgentToolSet::IsReadOnly("  grep TODO src"));
+    assert(AgentToolSet::IsReadOnly("LIST\n"));
+    assert(AgentToolSet::IsReadOnly("FILE_INFO a.txt"));
+    assert(AgentToolSet::IsReadOnly("GIT_DIFF src/"));
+    assert(!AgentToolSet::IsReadOnly("WRITE a.txt 1 2\nx\nEND_WRITE\n"));
+    assert(!AgentToolSet::IsReadOnly("DELETE_LINES a.txt 1-2"));
+    assert(!AgentToolSet::IsReadOnly("FINISH done"));
+    assert(!AgentToolSet::IsReadOnly(""));
+
+    std::cout << "  PASSED" << std::endl;
+}
+
 void test_path_safety() {
     std::cout << "Testing path safety (no directory traversal)..." << std::endl;
 
@@ -306,6 +373,13 @@ void test_path_safety() {
     result = toolset.ReadLines("/etc/passwd", 1, 5);
     assert(!result.success);
 
+    // GIT_DIFF paths reach a shell, so only plain paths are accepted
+    result = toolset.Execute("GIT_DIFF safe.txt;rm -rf x");
+    assert(!result.success);
+    assert(result.error.find("Invalid path") != std::string::npos);
+    result = toolset.GitDiff("../outside");
+    assert(!result.success);
+
     fs::remove_all(test_dir);
     std::cout << "  PASSED" << std::endl;
 }
@@ -324,6 +398,8 @@ int main() {
         test_delete_lines();
         test_create_file();
         test_execute_command();
+        test_execute_batch();
+        test_is_read_only();
         test_path_safety();
 
         std::cout << "\n=== All tests PASSED ===" << std::endl;
@@ -0,0 +1,79 @@
+#include "coder/command_stream_parser.hpp"
+#include <cassert>
+#include <iostream>
+
+using namespace zweek::coder;
+
+void TestSingleLineCommand() {
+    CommandStreamParser parser;
+    assert(!parser.Feed("THOUGHT: list the sources\n"));
+    assert(!parser.Feed("CMD: LIST"));
+    assert(!parser.Feed(" src/"));
+    assert(parser.Feed("\nRES"));
+    assert(parser.Complete());
+    assert(parser.Commands().back() == "LIST src/\n");
+
+    // Later text is ignored
+    assert(parser.Feed("more"));
+    assert(parser.Commands().back() == "LIST src/\n");
+
+    std::cout << "TestSingleLineCommand passed!" << std::endl;
+}
+
+void TestPrefixSplitAcrossPieces() {
+    CommandStreamParser parser;
+    std::string output = "THOUGHT: read it\nCMD: READ_LINES a.cpp 1-20\n";
+    for (char c : output) {
+        parser.Feed(std::string(1, c));
+    }
+    assert(parser.Complete());
+    assert(parser.Commands().back() == "READ_LINES a.cpp 1-20\n");
+    assert(parser.Size() == output.size());
+
+    std::cout << "TestPrefixSplitAcrossPieces passed!" << std::endl;
+}
+
+void TestBlockCommandWaitsForEndMarker() {
+    CommandStreamParser parser;
+    assert(!parser.Feed("THOUGHT: fix it\nCMD: WRITE a.cpp 3 3\n"));
+    assert(!parser.Feed("int x = 1;\nEND_WR"));
+    assert(!parser.Feed("ITE"));
+    assert(parser.Feed("\n"));
+    assert(parser.Commands().back() == "WRITE a.cpp 3 3\nint x = 1;\nEND_WRITE\n");
+
+    parser.Reset();
+    assert(!parser.Complete());
+    assert(parser.Size() == 0);
+    assert(!parser.Feed("THOUGHT: add\nCMD: INSERT a.cpp 0\n#pragma once\n"));
+    assert(parser.Feed("END_INSERT\n"));
+    assert(parser.Commands().back() == "INSERT a.cpp 0\n#pragma once\nEND_INSERT\n");
+
+    std::cout << "TestBlockCommandWaitsForEndMarker passed!" << std::endl;
+}
+
+void TestBatchOfCommands() {
+    CommandStreamParser parser(3);
+    assert(!parser.Feed("THOUGHT: look around\nCMD: LIST src/\n"));
+    assert(parser.Commands().size() == 1);
+    assert(!parser.Feed("CMD: GREP Init src\nCM"));
+    assert(parser.Commands().size() == 2);
+    assert(parser.Feed("D: READ_LINES a.cpp 1-9\nCMD: LIST .\n"));
+    assert(parser.Commands().size() == 3);
+    assert(parser.Commands()[1] == "GREP Init src\n");
+    assert(parser.Commands()[2] == "READ_LINES a.cpp 1-9\n");
+
+    // FINISH ends a batch early
+    CommandStreamParser finish(4);
+    assert(finish.Feed("THOUGHT: done\nCMD: LIST a\nCMD: FINISH all good\n"));
+    assert(finish.Commands().size() == 2);
+
+    std::cout << "TestBatchOfCommands passed!" << std::endl;
+}
+
+int main() {
+    TestSingleLineCommand();
+    TestPrefixSplitAcrossPieces();
+    TestBlockCommandWaitsForEndMarker();
+    TestBatchOfCommands();
+    return 0;
+}
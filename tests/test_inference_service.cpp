@@ -0,0 +1,159 @@
+#include "pipeline/inference_service.hpp"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace zweek::pipeline;
+
+// Wait (bounded) until cond holds
+template <typename F> bool WaitFor(F cond) {
+  for (int i = 0; i < 500 && !cond(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return cond();
+}
+
+void TestResultAndTokens() {
+  InferenceService service;
+  auto handle = service.Submit([](JobContext &job) {
+    job.tokens->Push("Hello");
+    job.tokens->Push(", world");
+    return std::string("Hello, world");
+  });
+
+  assert(handle.Result().get() == "Hello, world");
+
+  std::string streamed, chunk;
+  while (handle.Tokens()->Pop(chunk)) {
+    streamed += chunk;
+  }
+  assert(streamed == "Hello, world");
+
+  std::cout << "TestResultAndTokens passed!" << std::endl;
+}
+
+void TestPriorityOrder() {
+  InferenceService service;
+  std::promise<void> release;
+  std::shared_future<void> gate = release.get_future().share();
+  std::string order;
+  std::mutex order_mutex;
+
+  // Hold the worker so the next jobs queue up
+  auto blocker = service.Submit([gate](JobContext &) {
+    gate.wait();
+    return std::string();
+  }, Priority::Foreground);
+  assert(WaitFor([&] { return service.IsBusy(); }));
+
+  auto record = [&](const std::string &name) {
+    return [&, name](JobContext &) {
+      std::lock_guard<std::mutex> lock(order_mutex);
+      order += name;
+      return name;
+    };
+  };
+  auto low = service.Submit(record("L"), Priority::Background);
+  auto normal1 = service.Submit(record("N1"), Priority::Normal);
+  auto normal2 = service.Submit(record("N2"), Priority::Normal);
+  assert(service.QueuedCount() == 3);
+
+  release.set_value();
+  low.Result().wait();
+  assert(order == "N1N2L");
+
+  std::cout << "TestPriorityOrder passed!" << std::endl;
+}
+
+void TestCancel() {
+  InferenceService service;
+
+  // Running job observes its cancel flag
+  auto running = service.Submit([](JobContext &job) {
+    while (!job.cancel->load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return std::string("stopped");
+  });
+  assert(WaitFor([&] { return service.IsBusy(); }));
+
+  // Queued job is dropped without running
+  bool ran = false;
+  auto queued = service.Submit([&ran](JobContext &) {
+    ran = true;
+    return std::string("ran");
+  });
+  queued.Cancel();
+  running.Cancel();
+
+  assert(running.Result().get() == "stopped");
+  assert(queued.Result().get() == "[cancelled]");
+  assert(!ran);
+  assert(queued.Tokens()->IsClosed());
+
+  std::cout << "TestCancel passed!" << std::endl;
+}
+
+void TestBoundedQueue() {
+  InferenceService service(1);
+  std::promise<void> release;
+  std::shared_future<void> gate = release.get_future().share();
+
+  auto blocker = service.Submit([gate](JobContext &) {
+    gate.wait();
+    return std::string();
+  });
+  assert(WaitFor([&] { return service.IsBusy(); }));
+
+  auto first = service.Submit([](JobContext &) { return std::string("ok"); });
+  auto rejected =
+      service.Submit([](JobContext &) { return std::string("ok"); });
+  assert(rejected.Result().get() == "[Error: Inference queue full]");
+
+  release.set_value();
+  assert(first.Result().get() == "ok");
+
+  std::cout << "TestBoundedQueue passed!" << std::endl;
+}
+
+void TestPreemption() {
+  InferenceService service;
+  std::atomic<int> attempts{0};
+  std::atomic<bool> foreground_done{false};
+
+  // Background work that runs until told to stop
+  auto background = service.Submit([&](JobContext &job) {
+    int attempt = ++attempts;
+    if (attempt == 1) {
+      while (!job.cancel->load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return std::string("preempted");
+    }
+    // Restarted after the foreground job
+    return std::string(foreground_done ? "resumed" : "too early");
+  }, Priority::Background);
+  assert(WaitFor([&] { return attempts.load() == 1; }));
+
+  auto foreground = service.Submit([&](JobContext &) {
+    foreground_done = true;
+    return std::string("foreground");
+  }, Priority::Foreground);
+
+  assert(foreground.Result().get() == "foreground");
+  assert(background.Result().get() == "resumed");
+  assert(attempts == 2);
+
+  std::cout << "TestPreemption passed!" << std::endl;
+}
+
+int main() {
+  TestResultAndTokens();
+  TestPriorityOrder();
+  TestCancel();
+  TestBoundedQueue();
+  TestPreemption();
+  return 0;
+}
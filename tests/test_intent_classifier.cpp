@@ -0,0 +1,114 @@
+#include "pipeline/intent_classifier.hpp"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace zweek::pipeline;
+
+const int CODE = 0, CHAT = 1, TOOL = 2;
+
+std::vector<IntentExample> Examples() {
+  return {
+      {"add error handling to the parser", CODE},
+      {"refactor this function", CODE},
+      {"write a unit test for main", CODE},
+      {"fix the bug in the tokenizer", CODE},
+      {"implement a cache class", CODE},
+      {"what does this do", CHAT},
+      {"explain the auth flow", CHAT},
+      {"why is the build slow", CHAT},
+      {"how does the router work", CHAT},
+      {"what is a kv cache", CHAT},
+      {"find all todos", TOOL},
+      {"grep for main", TOOL},
+      {"list files in src", TOOL},
+      {"search for database queries", TOOL},
+      {"show me where config is loaded", TOOL},
+  };
+}
+
+void TestTrainPredict() {
+  IntentClassifier classifier;
+  assert(!classifier.IsTrained());
+
+  auto examples = Examples();
+  classifier.Train(examples, 30);
+  assert(classifier.IsTrained());
+  assert(classifier.Evaluate(examples) == 1.0f);
+
+  auto probs = classifier.Predict("refactor this function");
+  assert(probs.size() == 3);
+  assert(probs[CODE] > probs[CHAT] && probs[CODE] > probs[TOOL]);
+
+  std::cout << "TestTrainPredict passed!" << std::endl;
+}
+
+void TestSaveLoad() {
+  std::string path = "test_intent_classifier.bin";
+  IntentClassifier trained;
+  trained.Train(Examples(), 30);
+  assert(trained.Save(path));
+
+  IntentClassifier loaded;
+  assert(loaded.Load(path));
+  auto a = trained.Predict("explain the auth flow");
+  auto b = loaded.Predict("explain the auth flow");
+  for (size_t i = 0; i < a.size(); ++i) {
+    assert(a[i] == b[i]);
+  }
+
+  // Wrong file is rejected
+  {
+    std::ofstream bad(path);
+    bad << "not weights";
+  }
+  IntentClassifier rejected;
+  assert(!rejected.Load(path));
+  assert(!rejected.IsTrained());
+
+  fs::remove(path);
+
+  std::cout << "TestSaveLoad passed!" << std::endl;
+}
+
+void TestReadDecisionLog() {
+  std::string path = "test_router_decisions.jsonl";
+  {
+    std::ofstream log(path);
+    log << R"({"input":"fix the bug","intent":"code","confidence":0.9})" << "\n";
+    log << R"({"input":"hmm","intent":"chat","confidence":0.4})" << "\n";
+    log << R"({"input":"grep main","intent":"tool"})" << "\n";
+    log << "not json\n";
+    log << R"({"input":"x","intent":"unknown"})" << "\n";
+  }
+
+  auto examples = IntentClassifier::ReadDecisionLog(path, 0.6f);
+  assert(examples.size() == 2);
+  assert(examples[0].input == "fix the bug" && examples[0].label == CODE);
+  assert(examples[1].label == TOOL);
+
+  fs::remove(path);
+
+  std::cout << "TestReadDecisionLog passed!" << std::endl;
+}
+
+// The router's grammar fallback reads its label back with FindLabel
+void TestFindLabel() {
+  assert(IntentClassifier::FindLabel("TOOL") == TOOL);
+  assert(IntentClassifier::FindLabel(" CODE\n") == CODE);
+  assert(IntentClassifier::FindLabel("Chat") == CHAT);
+  assert(IntentClassifier::FindLabel("") == -1);
+  assert(IntentClassifier::FindLabel("unsure") == -1);
+
+  std::cout << "TestFindLabel passed!" << std::endl;
+}
+
+int main() {
+  TestTrainPredict();
+  TestSaveLoad();
+  TestReadDecisionLog();
+  TestFindLabel();
+  return 0;
+}
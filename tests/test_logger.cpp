@@ -0,0 +1,127 @@
+#include "logging/logger.hpp"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace zweek::logging;
+
+std::string ReadFile(const fs::path &path) {
+  std::ifstream file(path);
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+int CountLines(const std::string &text) {
+  int lines = 0;
+  for (char c : text) {
+    lines += c == '\n';
+  }
+  return lines;
+}
+
+// Runs before Start: nothing drains the ring, so it fills up
+void TestFullRingDropsInsteadOfBlocking() {
+  Logger &logger = Logger::Instance();
+  for (int i = 0; i < 1024 + 10; ++i) {
+    logger.Log(LogLevel::Info, "test", "queued before start");
+  }
+  assert(logger.DroppedCount() == 10);
+
+  std::cout << "TestFullRingDropsInsteadOfBlocking passed!" << std::endl;
+}
+
+void TestWritesAndRotates() {
+  fs::path dir = "test_logs";
+  fs::remove_all(dir);
+
+  // Stop drains the backlog queued by the previous test
+  Logger &logger = Logger::Instance();
+  assert(logger.Start(dir.string(), 16 * 1024, 2));
+  logger.Stop();
+
+  assert(logger.Start(dir.string(), 16 * 1024, 2));
+  logger.SetLevel(LogLevel::Info);
+  LogDebug("test", "filtered out");
+  LogWarn("test", "a warning\n");
+  logger.Stop();
+
+  // The queued backlog, the drop note and the warning, spread over
+  // rotated files of at most ~16 KiB
+  assert(fs::exists(dir / "zweek.log"));
+  assert(fs::exists(dir / "zweek.1.log"));
+  assert(fs::exists(dir / "zweek.2.log"));
+  assert(!fs::exists(dir / "zweek.3.log"));
+
+  std::string current = ReadFile(dir / "zweek.log");
+  assert(current.find("WARN test: a warning\n") != std::string::npos);
+  assert(current.find("filtered out") == std::string::npos);
+
+  std::string all = ReadFile(dir / "zweek.2.log") +
+                    ReadFile(dir / "zweek.1.log") + current;
+  assert(all.find("WARN logger: dropped 10 messages") != std::string::npos);
+  assert(CountLines(all) < 1024 + 2); // The oldest rotated file is gone
+
+  fs::remove_all(dir);
+  std::cout << "TestWritesAndRotates passed!" << std::endl;
+}
+
+void TestTruncatesLongMessages() {
+  fs::path dir = "test_logs";
+  fs::remove_all(dir);
+
+  Logger &logger = Logger::Instance();
+  assert(logger.Start(dir.string()));
+  LogError("test", std::string(1000, 'x'));
+  logger.Stop();
+
+  std::string text = ReadFile(dir / "zweek.log");
+  assert(CountLines(text) == 1);
+  assert(text.find("ERROR test: xxx") != std::string::npos);
+  assert(text.size() < 300);
+
+  fs::remove_all(dir);
+  std::cout << "TestTruncatesLongMessages passed!" << std::endl;
+}
+
+void TestConcurrentProducers() {
+  fs::path dir = "test_logs";
+  fs::remove_all(dir);
+
+  // Fewer messages than ring slots, so none can be dropped
+  Logger &logger = Logger::Instance();
+  assert(logger.Start(dir.string()));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < 200; ++i) {
+        LogInfo("thread" + std::to_string(t), std::to_string(i));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  logger.Stop();
+
+  std::string text = ReadFile(dir / "zweek.log");
+  assert(CountLines(text) == 800);
+  assert(text.find("INFO thread3: 199\n") != std::string::npos);
+
+  fs::remove_all(dir);
+  std::cout << "TestConcurrentProducers passed!" << std::endl;
+}
+
+int main() {
+  TestFullRingDropsInsteadOfBlocking();
+  TestWritesAndRotates();
+  TestTruncatesLongMessages();
+  TestConcurrentProducers();
+  return 0;
+}
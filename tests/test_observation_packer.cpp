@@ -0,0 +1,101 @@
+#include "coder/observation_packer.hpp"
+#include <cassert>
+#include <iostream>
+
+using namespace zweek::coder;
+
+namespace {
+
+// One token per whitespace-separated word, plus one for the newline
+int CountWords(const std::string& text) {
+    int tokens = 0;
+    bool in_word = false;
+    for (char c : text) {
+        if (c == ' ' || c == '\n') {
+            in_word = false;
+            tokens += (c == '\n');
+        } else if (!in_word) {
+            in_word = true;
+            tokens++;
+        }
+    }
+    return tokens;
+}
+
+std::string Marker(int first, int last, int total) {
+    return "[elided " + std::to_string(first) + "-" + std::to_string(last) +
+           " of " + std::to_string(total) + "]";
+}
+
+std::string NumberedLines(int n) {
+    std::string text;
+    for (int i = 1; i <= n; ++i) {
+        text += std::to_string(i) + ": some code here\n";
+    }
+    return text;
+}
+
+}  // namespace
+
+void TestFitsUnchanged() {
+    ObservationPacker packer(CountWords);
+    std::string output = NumberedLines(5);
+    PackedObservation packed = packer.Pack(output, 100, Marker);
+    assert(packed.text == output);
+    assert(packed.tokens == 25);
+    assert(packed.total_lines == 5);
+    assert(!packed.Elided());
+
+    std::cout << "TestFitsUnchanged passed!" << std::endl;
+}
+
+void TestElidesMiddleAtLineBoundaries() {
+    ObservationPacker packer(CountWords);
+    std::string output = NumberedLines(100);
+    PackedObservation packed = packer.Pack(output, 60, Marker);
+
+    assert(packed.Elided());
+    assert(packed.tokens <= 60);
+    assert(packed.total_lines == 100);
+    assert(packed.text.rfind("1: some code here\n", 0) == 0);
+    assert(packed.text.find("100: some code here\n") != std::string::npos);
+
+    std::string marker = Marker(packed.elided_first, packed.elided_last, 100) + "\n";
+    assert(packed.text.find(marker) != std::string::npos);
+
+    // Every kept line is whole: head, marker, tail
+    [[maybe_unused]] int head = packed.elided_first - 1;
+    [[maybe_unused]] int tail = 100 - packed.elided_last;
+    assert(head > tail && tail > 0);
+    assert(packed.tokens == (head + tail) * 5 + CountWords(marker));
+
+    std::cout << "TestElidesMiddleAtLineBoundaries passed!" << std::endl;
+}
+
+void TestCachesLineCounts() {
+    int calls = 0;
+    ObservationPacker packer([&calls](const std::string& text) {
+        calls++;
+        return CountWords(text);
+    });
+
+    packer.Pack(NumberedLines(10), 1000, Marker);
+    assert(calls == 10);
+    assert(packer.CacheSize() == 10);
+
+    // Overlapping range: only the new lines are tokenized
+    packer.Pack(NumberedLines(15), 1000, Marker);
+    assert(calls == 15);
+
+    packer.ClearCache();
+    assert(packer.CacheSize() == 0);
+
+    std::cout << "TestCachesLineCounts passed!" << std::endl;
+}
+
+int main() {
+    TestFitsUnchanged();
+    TestElidesMiddleAtLineBoundaries();
+    TestCachesLineCounts();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "pipeline/route_cache.hpp"
+#include <iostream>
+#include <cassert>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+using namespace zweek::pipeline;
+
+void TestNormalize() {
+  assert(RouteCache::Normalize("  List   Files? ") == "list files");
+  assert(RouteCache::Normalize("Fix the BUG.") == "fix the bug");
+  assert(RouteCache::Normalize("") == "");
+
+  std::cout << "TestNormalize passed!" << std::endl;
+}
+
+void TestLruEviction() {
+  RouteCache cache("", 2);
+  std::string label;
+
+  cache.Insert("add a test", "code");
+  cache.Insert("what is this", "chat");
+  assert(cache.Lookup("Add a test!", label) && label == "code");
+
+  // "what is this" is now least recently used
+  cache.Insert("find todos", "tool");
+  assert(cache.Size() == 2);
+  assert(!cache.Lookup("what is this", label));
+  assert(cache.Lookup("add a test", label) && label == "code");
+  assert(cache.Lookup("find todos", label) && label == "tool");
+
+  std::cout << "TestLruEviction passed!" << std::endl;
+}
+
+void TestPersistence() {
+  std::string test_dir = "test_route_cache";
+  if (fs::exists(test_dir)) {
+    fs::remove_all(test_dir);
+  }
+  std::string path = test_dir + "/routes.json";
+
+  {
+    RouteCache cache(path);
+    cache.Insert("explain the auth flow", "chat");
+    cache.Insert("refactor main", "code");
+  }
+  assert(fs::exists(path));
+
+  RouteCache reloaded(path);
+  std::string label;
+  assert(reloaded.Size() == 2);
+  assert(reloaded.Lookup("Explain the auth flow", label) && label == "chat");
+  assert(reloaded.Lookup("refactor main", label) && label == "code");
+
+  fs::remove_all(test_dir);
+
+  std::cout << "TestPersistence passed!" << std::endl;
+}
+
+int main() {
+  TestNormalize();
+  TestLruEviction();
+  TestPersistence();
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include "models/stop_sequence_matcher.hpp"
+#include <cassert>
+#include <iostream>
+
+using namespace zweek::models;
+
+void TestNoStops() {
+  StopSequenceMatcher matcher;
+  assert(matcher.Feed("hello") == "hello");
+  assert(matcher.Feed(" world") == " world");
+  assert(!matcher.Matched());
+  assert(matcher.Flush().empty());
+
+  std::cout << "TestNoStops passed!" << std::endl;
+}
+
+void TestMatchWithinPiece() {
+  StopSequenceMatcher matcher({"\nRESULT:"});
+  assert(matcher.Feed("CMD: LIST src/\nRESULT: main.cpp") == "CMD: LIST src/");
+  assert(matcher.Matched());
+  assert(matcher.Feed("more") == "");
+
+  std::cout << "TestMatchWithinPiece passed!" << std::endl;
+}
+
+void TestMatchAcrossPieces() {
+  StopSequenceMatcher matcher({"</answer>"});
+  std::string released;
+  for (const char *piece : {"The answer", " is 4<", "/ans", "wer", ">tail"}) {
+    released += matcher.Feed(piece);
+  }
+  assert(matcher.Matched());
+  assert(released == "The answer is 4");
+
+  std::cout << "TestMatchAcrossPieces passed!" << std::endl;
+}
+
+void TestHeldTextReleasedWhenRuledOut() {
+  StopSequenceMatcher matcher({"END"});
+  assert(matcher.Feed("the E") == "the ");
+  assert(matcher.Feed("N") == "");
+  assert(matcher.Feed("D") == "");
+  assert(matcher.Matched());
+
+  matcher.Reset();
+  assert(!matcher.Matched());
+  assert(matcher.Feed("an E") == "an ");
+  assert(matcher.Feed("ND") == "");
+  assert(matcher.Matched());
+
+  matcher.Reset();
+  assert(matcher.Feed("EN") == "");
+  assert(matcher.Feed("Ergy") == "ENErgy");
+  assert(matcher.Feed(" E") == " ");
+  assert(matcher.Flush() == "E");
+  assert(!matcher.Matched());
+
+  std::cout << "TestHeldTextReleasedWhenRuledOut passed!" << std::endl;
+}
+
+void TestEarliestStopWins() {
+  StopSequenceMatcher matcher({"world", "lo w"});
+  assert(matcher.Feed("hello world") == "hel");
+  assert(matcher.Matched());
+
+  std::cout << "TestEarliestStopWins passed!" << std::endl;
+}
+
+int main() {
+  TestNoStops();
+  TestMatchWithinPiece();
+  TestMatchAcrossPieces();
+  TestHeldTextReleasedWhenRuledOut();
+  TestEarliestStopWins();
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include "models/stream_sink.hpp"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zweek::models;
+using namespace std::chrono_literals;
+
+void TestBatchesByTokenCount() {
+  std::vector<std::string> chunks;
+  StreamSink sink([&](const std::string &text) { chunks.push_back(text); }, 3,
+                  std::chrono::microseconds(std::chrono::hours(1)));
+
+  // The first piece flushes at once: nothing has been delivered yet
+  sink.Write("a");
+  assert(chunks.size() == 1 && chunks[0] == "a");
+
+  // Then callbacks come every third piece
+  for (const char *piece : {"b", "c", "d", "e", "f"}) {
+    sink.Write(piece);
+  }
+  assert(chunks.size() == 2 && chunks[1] == "bcd");
+
+  sink.Flush();
+  assert(chunks.size() == 3 && chunks[2] == "ef");
+
+  // Nothing pending: Flush does not call back
+  sink.Flush();
+  assert(chunks.size() == 3);
+
+  std::cout << "TestBatchesByTokenCount passed!" << std::endl;
+}
+
+void TestFlushesAfterInterval() {
+  std::vector<std::string> chunks;
+  StreamSink sink([&](const std::string &text) { chunks.push_back(text); },
+                  100, 50ms);
+
+  sink.Write("first");
+  sink.Write(" x");
+  assert(chunks.size() == 1);
+
+  // A slow stream is delivered as it arrives
+  std::this_thread::sleep_for(100ms);
+  sink.Write(" y");
+  assert(chunks.size() == 2 && chunks[1] == " x y");
+
+  std::cout << "TestFlushesAfterInterval passed!" << std::endl;
+}
+
+void TestNoCallback() {
+  StreamSink sink(nullptr);
+  sink.Write("ignored");
+  sink.Flush();
+
+  std::cout << "TestNoCallback passed!" << std::endl;
+}
+
+int main() {
+  TestBatchesByTokenCount();
+  TestFlushesAfterInterval();
+  TestNoCallback();
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include "coder/tool_plan.hpp"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using namespace zweek::coder;
+
+void TestParsePlan() {
+    std::vector<PlanStep> steps;
+    assert(ParseToolPlan(R"([
+        {"type": "read_file", "path": "src/main.cpp"},
+        {"type": "search", "path": "src", "pattern": "Init"},
+        {"type": "delete_all", "path": "src"},
+        {"type": "git_diff", "path": ""},
+        {"type": "write_file", "path": "src/main.cpp"}
+    ])", steps));
+    assert(steps.size() == 3);
+    assert(steps[1].pattern == "Init");
+    assert(steps[2].type == "write_file");
+
+    assert(!ParseToolPlan("[{\"type\": \"read_file\"", steps));
+    assert(!ParseToolPlan("{\"type\": \"read_file\"}", steps));
+
+    assert(PlanStepCommand({"read_file", "a.cpp", ""}) == "READ_LINES a.cpp 1-50\n");
+    assert(PlanStepCommand({"search", "src", "TODO"}) == "GREP TODO src\n");
+    assert(PlanStepCommand({"git_diff", ".", ""}) == "GIT_DIFF .\n");
+    assert(PlanStepCommand({"search", "src", ""}).empty());
+    assert(PlanStepCommand({"write_file", "a.cpp", ""}).empty());
+
+    std::cout << "TestParsePlan passed!" << std::endl;
+}
+
+void TestRunPlan() {
+    fs::path dir = fs::temp_directory_path() / "zweek_plan_test";
+    fs::create_directories(dir);
+    for (int i = 0; i < 6; ++i) {
+        std::ofstream(dir / ("f" + std::to_string(i) + ".txt")) << "file " << i << "\n";
+    }
+    AgentToolSet toolset(dir.string());
+
+    std::vector<PlanStep> steps;
+    for (int i = 0; i < 6; ++i) {
+        steps.push_back({"read_file", "f" + std::to_string(i) + ".txt", ""});
+    }
+    steps.push_back({"read_file", "f0.txt", ""});  // Duplicate
+    steps.push_back({"write_file", "f1.txt", ""});
+
+    // More lookups than one batch; results stay in plan order
+    std::vector<std::string> commands, edit_targets;
+    auto results = RunToolPlan(toolset, steps, 8, commands, edit_targets);
+    assert(commands.size() == 6);
+    assert(results.size() == 6);
+    for (int i = 0; i < 6; ++i) {
+        assert(results[i].success);
+        assert(results[i].output.find("file " + std::to_string(i)) != std::string::npos);
+    }
+    assert(edit_targets.size() == 1 && edit_targets[0] == "f1.txt");
+
+    // Bounded by max_lookups
+    results = RunToolPlan(toolset, steps, 2, commands, edit_targets);
+    assert(commands.size() == 2 && results.size() == 2);
+
+    fs::remove_all(dir);
+    std::cout << "TestRunPlan passed!" << std::endl;
+}
+
+int main() {
+    TestParsePlan();
+    TestRunPlan();
+    return 0;
+}